@@ -9,12 +9,53 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
 #include <chrono>
 #include <thread>
 #include <atomic>
 #include <array>
 #include <map>
+#include <set>
+#include <memory>
+#include <string_view>
+#include <new>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <csignal>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef __linux__
+    #include <sys/inotify.h>
+    #include <sys/eventfd.h>
+    #include <sys/epoll.h>
+    #include <sys/timerfd.h>
+    #include <sys/prctl.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+#if defined __linux__ || defined __unix__
+    #include <spawn.h>
+    #include <fcntl.h>
+    #include <sys/wait.h>
+    #include <sys/stat.h>
+    #include <signal.h>
+    #include <sys/mman.h>
+    #include <sys/resource.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    extern char** environ;
+#endif
+// Optional in-process compile engine; build with -DSHADERASSIST_SHADERC and link against libshaderc (e.g. -lshaderc_shared)
+#ifdef SHADERASSIST_SHADERC
+    #include <shaderc/shaderc.h>
+#endif
 
 #ifdef _MSC_VER
     namespace fs = std::experimental::filesystem;
@@ -24,111 +65,3753 @@
     namespace fs = std::filesystem;
 #endif
 
-// Configuration (values extracted from .ini file)
-// ----------------------------------------------------------------------------------
-struct Config {
-    // compile all shaders on startup ShaderAssist
-    bool CompileOnStartup;
-    // use Google's SPIR-V compiler (more features including preprocess #include support)
-    bool UseGoogleSPIRV;
-    // generate SPIR-V metadata (useful for automatic pipeline/descriptor generation) using spirv-cross
-    bool GenerateMetaData;
-    // path to the Vulkan SPIR-V compiler
-    std::string GLSLLangValidatorPath;
-    // path to the Google SPIR-V compiler
-    std::string GLSLCPath;
-    // folder to read/check for modified shader source files (use / for absolute paths)
-    std::string ShaderSourcePath;
-    // output compiled SPIRV path (use / for absolute paths)
-    std::string SPIRVOutputPath;
-    // SPIRV output extension
-    std::string SPIRVExt;
-    // vertex shader extension
-    std::string VSExt;
-    // fragment shader extension
-    std::string FSExt;
-    // compute shader extension
-    std::string CSExt;
-    // geometry shader extension
-    std::string GSExt;
-} config;
+// Configuration (values extracted from .ini file)
+// ----------------------------------------------------------------------------------
+struct Config {
+    // compile all shaders on startup ShaderAssist (with a manifest of a previous run, only the shaders modified since are compiled)
+    bool CompileOnStartup;
+    // use Google's SPIR-V compiler (more features including preprocess #include support)
+    bool UseGoogleSPIRV;
+    // compile in-process through the linked shaderc library instead of starting an external compiler for each shader
+    // (requires a build with SHADERASSIST_SHADERC defined)
+    bool UseInProcessCompiler;
+    // generate SPIR-V metadata (useful for automatic pipeline/descriptor generation) as a .json file next to each compiled shader
+    bool GenerateMetaData;
+    // path to the Vulkan SPIR-V compiler
+    std::string GLSLLangValidatorPath;
+    // path to the Google SPIR-V compiler
+    std::string GLSLCPath;
+    // folder to read/check for modified shader source files, including its subfolders (use / for absolute paths)
+    std::string ShaderSourcePath;
+    // output compiled SPIRV path, mirrors the subfolders of the shader source folder (use / for absolute paths)
+    std::string SPIRVOutputPath;
+    // SPIRV output extension
+    std::string SPIRVExt;
+    // output file name template ({file}, {name}, {stage}, {spirv_ext}) for stages without their own (see sShaderStages)
+    std::string OutputName;
+    // file change detection: "inotify" (Linux only, blocks on kernel events) or "poll" (re-scan directory every second)
+    std::string WatchMode;
+    // number of shaders compiled in parallel (0 or empty for the number of CPU cores)
+    unsigned int Jobs;
+    // time in milliseconds a shader has to stay unmodified before it's compiled; coalesces the multiple writes of a single save
+    unsigned int DebounceMilliseconds;
+    // folder of the content-addressed compile cache (empty to disable); previously compiled sources are restored from here
+    std::string CompileCachePath;
+    // minimum level of logged messages: "debug", "info" (default), "warning" or "error"
+    std::string LogThreshold;
+    // file log messages are appended to as JSON lines (empty to only log to the console)
+    std::string LogFilePath;
+    // file the compile latency statistics are written to (as JSON) on exit (empty to disable)
+    std::string StatsFilePath;
+    // file a Chrome trace (chrome://tracing, Perfetto) of scans, queue waits and compiles is written to (empty to disable)
+    std::string TraceFilePath;
+    // Unix socket engines can connect to for compiled/failed shader notifications (empty to disable)
+    std::string NotifySocketPath;
+    // name of the shared-memory segment compiled SPIR-V is delivered through (e.g. /shaderassist; empty to disable)
+    std::string SharedMemoryName;
+    // size of the shared-memory SPIR-V ring in megabytes
+    unsigned int SharedMemoryMegabytes;
+    // number of shared-memory index entries (0 to size it from the number of watched shaders)
+    unsigned int SharedMemoryIndexSize;
+    // file all compiled shaders are packed into (with a sorted hash index) for engines to map in one go (empty to disable)
+    std::string BundleFilePath;
+    // path to spirv-opt, run over every compiled shader (empty to disable)
+    std::string SPIRVOptPath;
+    // spirv-opt passes/options, space separated (e.g. -O, -Os, --strip-debug)
+    std::string SPIRVOptPasses;
+    // folder optimized modules are cached in (empty for the compile cache folder, or .optcache in the SPIR-V output folder)
+    std::string SPIRVOptCachePath;
+} config;
+
+// Global state
+// ------------
+static std::atomic<bool> sApplicationExit = false;
+static std::atomic<bool> sRecompile       = false;
+static bool              sFirstIteration  = true;
+// headless batch build (--once/--build): compile everything that's out-of-date once and exit
+static bool              sBuildMode       = false;
+// compile results (for the batch build summary)
+static std::atomic<unsigned int> sCompiledCount = 0;
+static std::atomic<unsigned int> sRestoredCount = 0;
+static std::atomic<unsigned int> sFailedCount   = 0;
+#ifdef __linux__
+// eventfd used to wake up the blocking event loop (on finished compiles, quit or forced recompile)
+static int               sWakeEventFd     = -1;
+#endif
+// set while the main thread event loop is running (it then handles the manifest saves after compiles finish)
+static std::atomic<bool> sEventLoopRunning = false;
+// arguments passed to glslc ahead of all others (the benchmark's stand-in compiler mode, e.g. --mock-compiler <ms>)
+static std::vector<std::string> sCompilerLeadingArguments;
+
+// Append a string to JSON output with the required escaping
+void appendJsonString(std::string& json, const std::string& string) {
+    json += '"';
+    for(char c : string) {
+        if(c == '"' || c == '\\') {
+            json += '\\';
+            json += c;
+        } else if(static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            json += escaped;
+        } else {
+            json += c;
+        }
+    }
+    json += '"';
+}
+
+// Asynchronous logger; any thread pushes records into a lock-free bounded ring buffer (multiple producers, single consumer) and 
+// a dedicated logger thread formats and writes them to the console and the optional JSON-lines log file. Producers never wait
+// for the logger: if the ring is full the record is dropped (and counted) rather than stalling change detection or compilation.
+// Producers do take the logger's mutex, but only to wake it when it's asleep on an empty ring; the logger holds it just from 
+// announcing it's going to sleep until it waits, so that wake-up can't get lost and the logger can sleep up to a second
+// ----------------------------------------------------------------------------------------------------------------------------
+enum class LogLevel { Debug, Info, Warning, Error };
+
+struct LogRecord {
+    std::atomic<uint64_t> Sequence; // ring position this slot can be written at (== position) or read at (== position + 1)
+    LogLevel              Level;
+    int64_t               Time;     // microseconds since epoch
+    unsigned int          Thread;   // index of the logging thread (in order of their first log)
+    std::string           Message;
+};
+static const uint64_t                sLogCapacity = 4096; // power of two
+static std::unique_ptr<LogRecord[]>  sLogRing;
+static std::atomic<uint64_t>         sLogWritePosition = 0;
+static uint64_t                      sLogReadPosition  = 0; // logger thread only
+static std::atomic<uint64_t>         sLogDropped       = 0;
+static std::atomic<unsigned int>     sLogThreadCount   = 0;
+static LogLevel                      sLogLevel         = LogLevel::Info;
+static std::ofstream                 sLogFile;
+// logger thread; it sleeps on the condition variable while the ring is empty (and sets sLoggerSleeping meanwhile)
+static std::thread                   sLoggerThread;
+static std::atomic<bool>             sLoggerRunning    = false;
+static std::atomic<bool>             sLoggerSleeping   = false;
+static std::atomic<bool>             sLoggerExit       = false;
+static std::mutex                    sLoggerMutex;
+static std::condition_variable       sLoggerCondition;
+
+const char* logLevelName(LogLevel level) {
+    switch(level) {
+        case LogLevel::Debug:   return "debug";
+        case LogLevel::Info:    return "info";
+        case LogLevel::Warning: return "warning";
+        default:                return "error";
+    }
+}
+
+// Write a single record to the console and log file (logger thread, or the calling thread while the logger isn't running)
+void writeLogRecord(LogLevel level, int64_t time, unsigned int thread, const std::string& message) {
+    std::cout << message << '\n';
+    if(sLogFile.is_open()) {
+        std::string json = "{\"time_us\":" + std::to_string(time) + ",\"level\":\"" + logLevelName(level) + "\",\"thread\":" + std::to_string(thread) + ",\"message\":";
+        appendJsonString(json, message);
+        json += "}\n";
+        sLogFile << json;
+    }
+}
+
+void loggerThread() {
+    while(true) {
+        // Drain everything that's published, then flush the batch at once
+        bool written = false;
+        while(true) {
+            LogRecord& record = sLogRing[sLogReadPosition & (sLogCapacity - 1)];
+            if(record.Sequence.load(std::memory_order_acquire) != sLogReadPosition + 1)
+                break;
+            std::string message = std::move(record.Message);
+            record.Message.clear();
+            LogLevel     level  = record.Level;
+            int64_t      time   = record.Time;
+            unsigned int thread = record.Thread;
+            record.Sequence.store(sLogReadPosition + sLogCapacity, std::memory_order_release);
+            ++sLogReadPosition;
+            writeLogRecord(level, time, thread, message);
+            written = true;
+        }
+        if(written) {
+            std::cout.flush();
+            if(sLogFile.is_open())
+                sLogFile.flush();
+            continue;
+        }
+        if(sLoggerExit)
+            return;
+        // Announce going to sleep before checking the ring a last time; a producer publishing meanwhile sees the flag and wakes us
+        std::unique_lock<std::mutex> lock(sLoggerMutex);
+        sLoggerSleeping = true;
+        if(sLogRing[sLogReadPosition & (sLogCapacity - 1)].Sequence.load() != sLogReadPosition + 1 && !sLoggerExit)
+            sLoggerCondition.wait_for(lock, std::chrono::seconds(1));
+        sLoggerSleeping = false;
+    }
+}
+
+// Start the logger thread with the .ini-specified level and JSON-lines log file; messages before this are written directly
+// -----------------------------------------------------------------------------------------------------------------------
+void startLogger() {
+    if(config.LogThreshold == "debug")
+        sLogLevel = LogLevel::Debug;
+    else if(config.LogThreshold == "warning")
+        sLogLevel = LogLevel::Warning;
+    else if(config.LogThreshold == "error")
+        sLogLevel = LogLevel::Error;
+    else
+        sLogLevel = LogLevel::Info;
+    if(!config.LogFilePath.empty()) {
+        sLogFile.open(config.LogFilePath, std::ios::app);
+        if(!sLogFile.is_open())
+            writeLogRecord(LogLevel::Warning, 0, 0, "Failed to open log file " + config.LogFilePath);
+    }
+    sLogRing.reset(new LogRecord[sLogCapacity]);
+    for(uint64_t i = 0; i < sLogCapacity; ++i)
+        sLogRing[i].Sequence.store(i, std::memory_order_relaxed);
+    sLoggerRunning = true;
+    sLoggerThread  = std::thread(loggerThread);
+}
+
+// Write out all pending records and stop the logger thread
+// -------------------------------------------------------
+void stopLogger() {
+    if(!sLoggerRunning)
+        return;
+    sLoggerExit = true;
+    {
+        std::lock_guard<std::mutex> lock(sLoggerMutex);
+    }
+    sLoggerCondition.notify_one();
+    sLoggerThread.join();
+    sLoggerRunning = false;
+    if(sLogDropped > 0)
+        writeLogRecord(LogLevel::Warning, 0, 0, std::to_string(sLogDropped) + " log message(s) dropped (log buffer full)");
+    std::cout.flush();
+    sLogFile.close();
+}
+
+void logMessage(LogLevel level, std::string message) {
+    static thread_local unsigned int thread = sLogThreadCount++;
+    int64_t time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if(!sLoggerRunning) {
+        writeLogRecord(level, time, thread, message);
+        std::cout.flush();
+        return;
+    }
+    // Claim the next free slot; a slot still holding an unread record means the ring is full
+    uint64_t position = sLogWritePosition.load(std::memory_order_relaxed);
+    while(true) {
+        LogRecord& record  = sLogRing[position & (sLogCapacity - 1)];
+        int64_t difference = static_cast<int64_t>(record.Sequence.load(std::memory_order_acquire) - position);
+        if(difference == 0) {
+            if(sLogWritePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                record.Level   = level;
+                record.Time    = time;
+                record.Thread  = thread;
+                record.Message = std::move(message);
+                record.Sequence.store(position + 1, std::memory_order_release);
+                break;
+            }
+        } else if(difference < 0) {
+            ++sLogDropped;
+            return;
+        } else {
+            position = sLogWritePosition.load(std::memory_order_relaxed);
+        }
+    }
+    // Only the first record after the logger went idle touches the mutex (held by the logger just until it starts waiting), so
+    // the notification can't get lost in between its last check and the wait
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(sLoggerSleeping) {
+        {
+            std::lock_guard<std::mutex> lock(sLoggerMutex);
+        }
+        sLoggerCondition.notify_one();
+    }
+}
+
+// Stream-style log statement; the message is pushed to the logger once the statement ends (e.g. Log(LogLevel::Info) << "x: " << x;)
+// messages below the .ini-specified level aren't formatted at all
+// -------------------------------------------------------------------------------------------------------------------------------
+struct Log {
+    LogLevel           Level;
+    bool               Enabled;
+    std::ostringstream Stream;
+
+    explicit Log(LogLevel level) : Level(level), Enabled(level >= sLogLevel) {}
+    ~Log() {
+        if(Enabled)
+            logMessage(Level, Stream.str());
+    }
+    template<typename T> Log& operator<<(const T& value) {
+        if(Enabled)
+            Stream << value;
+        return *this;
+    }
+};
+
+// Chrome trace-event export (open in chrome://tracing or Perfetto); scan passes on the main lane, each compile (and its compiler
+// run and output write) on the lane of the worker that ran it and queue waits as async spans. Events are appended to the file as
+// they happen, so the trace stays readable even if ShaderAssist doesn't exit cleanly (the closing bracket is optional)
+// ------------------------------------------------------------------------------------------------------------------------------
+static std::mutex                            sTraceMutex;
+static std::ofstream                         sTraceFile;
+static std::chrono::steady_clock::time_point sTraceStart;
+static uint64_t                              sTraceAsyncId = 0;
+static thread_local int                      sTraceLane    = 0; // 0 for the main thread, worker index + 1 for compile workers
+
+int64_t traceTimestamp(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - sTraceStart).count();
+}
+
+void writeTraceEvent(const std::string& event) {
+    std::lock_guard<std::mutex> lock(sTraceMutex);
+    sTraceFile << ",\n" << event;
+}
+
+// Open the trace file and name the lanes (main thread and compile workers)
+// -----------------------------------------------------------------------
+void startTrace(const std::string& path, unsigned int workers) {
+    sTraceFile.open(path, std::ios::trunc);
+    if(!sTraceFile.is_open()) {
+        Log(LogLevel::Warning) << "Failed to open trace file " << path << ", tracing disabled";
+        return;
+    }
+    sTraceStart = std::chrono::steady_clock::now();
+    sTraceFile << "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ShaderAssist\"}}";
+    sTraceFile << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main (scans)\"}}";
+    for(unsigned int i = 1; i <= workers; ++i)
+        sTraceFile << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":\"worker " << i << "\"}}";
+}
+
+void stopTrace() {
+    std::lock_guard<std::mutex> lock(sTraceMutex);
+    if(!sTraceFile.is_open())
+        return;
+    sTraceFile << "\n]\n";
+    sTraceFile.close();
+}
+
+// Complete span on the calling thread's lane; args is the contents of a JSON object (e.g. "\"result\":\"compiled\"")
+void traceSpan(const char* category, const std::string& name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, const std::string& args = "") {
+    if(!sTraceFile.is_open())
+        return;
+    std::string event = "{\"name\":";
+    appendJsonString(event, name);
+    event += ",\"cat\":\"" + std::string(category) + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(sTraceLane) + ",\"ts\":" + std::to_string(traceTimestamp(start)) + 
+             ",\"dur\":" + std::to_string(std::max<int64_t>(0, traceTimestamp(end) - traceTimestamp(start))) + ",\"args\":{" + args + "}}";
+    writeTraceEvent(event);
+}
+
+// Span that may overlap others (e.g. shaders waiting in the compile queue); shown on its own track
+void traceAsyncSpan(const char* category, const std::string& name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    if(!sTraceFile.is_open())
+        return;
+    std::string id;
+    {
+        std::lock_guard<std::mutex> lock(sTraceMutex);
+        id = std::to_string(++sTraceAsyncId);
+    }
+    std::string quotedName;
+    appendJsonString(quotedName, name);
+    std::string common = "{\"name\":" + quotedName + ",\"cat\":\"" + category + "\",\"id\":" + id + ",\"pid\":1,\"tid\":" + std::to_string(sTraceLane);
+    writeTraceEvent(common + ",\"ph\":\"b\",\"ts\":" + std::to_string(traceTimestamp(start)) + "}");
+    writeTraceEvent(common + ",\"ph\":\"e\",\"ts\":" + std::to_string(traceTimestamp(end)) + "}");
+}
+
+// Cheap fingerprint of a file's state used for change detection; gathered with a single stat call where available
+// ---------------------------------------------------------------------------------------------------------------
+struct FileStat {
+    int64_t  WriteTime; // full precision last write time (nanoseconds on POSIX, file clock ticks elsewhere)
+    uint64_t Size;
+    uint64_t Inode;     // changes when an editor saves by replacing the file (0 where unavailable)
+
+    bool operator==(const FileStat& other) const { return WriteTime == other.WriteTime && Size == other.Size && Inode == other.Inode; }
+    bool operator!=(const FileStat& other) const { return !(*this == other); }
+};
+
+bool statFile(const fs::path& path, FileStat& fileStat) {
+#if defined __linux__ || defined __unix__
+    struct stat status;
+    if(stat(path.c_str(), &status) != 0)
+        return false;
+    #ifdef __APPLE__
+        fileStat.WriteTime = static_cast<int64_t>(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+    #else
+        fileStat.WriteTime = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+    #endif
+    fileStat.Size  = status.st_size;
+    fileStat.Inode = status.st_ino;
+    return true;
+#else
+    std::error_code error;
+    fileStat.WriteTime = fs::last_write_time(path, error).time_since_epoch().count();
+    fileStat.Size      = fs::file_size(path, error);
+    fileStat.Inode     = 0;
+    return !error;
+#endif
+}
+
+// Time passed since a file was written according to its FileStat write time, in microseconds
+int64_t microsecondsSinceWrite(int64_t writeTime) {
+#if defined __linux__ || defined __unix__
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t nanoseconds = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec - writeTime;
+    return std::max<int64_t>(0, nanoseconds / 1000);
+#else
+    fs::file_time_type::duration age(fs::file_time_type::clock::now().time_since_epoch().count() - writeTime);
+    return std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(age).count());
+#endif
+}
+
+// Data structure for each watched file outside of the shader table (includes)
+// ----------------------------------------------------------------------------
+struct ShaderEntry {
+    FileStat  Stat; // state of the file when it was last checked
+    uint64_t  Hash; // hash of the file's contents when it was last checked
+};
+// Root of the watched shader source tree and the SPIR-V output folder (absolute); output mirrors the source tree's subdirectories
+static fs::path                        sShaderSourceRoot;
+static fs::path                        sSPIRVOutputRoot;
+
+// Returns whether a subdirectory of the shader source tree should be watched; skips hidden folders (.git, .cache) and the 
+// SPIR-V output folder in case it lives inside the source tree
+bool isWatchedDirectory(const fs::path& directory) {
+    std::string name = directory.filename().string();
+    return !name.empty() && name[0] != '.' && directory != sSPIRVOutputRoot;
+}
+
+// Handle to a running child process so it can be terminated from another thread (e.g. when the compile it runs became outdated)
+// ------------------------------------------------------------------------------------------------------------------------------
+struct ProcessHandle {
+    std::mutex Mutex;
+    int        Pid       = -1; // -1 while no process is running
+    bool       Cancelled = false;
+};
+
+void cancelProcess(ProcessHandle& process) {
+    std::lock_guard<std::mutex> lock(process.Mutex);
+    process.Cancelled = true;
+#if defined __linux__ || defined __unix__
+    if(process.Pid > 0)
+        kill(-process.Pid, SIGKILL);
+#endif
+}
+
+// Compile job queue; filled by the watcher thread and drained by the compile worker threads. Requests for the same shader are 
+// coalesced and only become ready once the shader stayed unmodified for the debounce window; at most one compile per shader runs
+// at a time and a compile is cancelled (or its result discarded) as soon as a newer version of the shader is queued
+// -------------------------------------------------------------------------------------------------------------------------------
+struct CompileJob {
+    fs::path                              Path;
+    uint64_t                              Generation; // request generation of the shader this compile started with
+    std::shared_ptr<ProcessHandle>        Process;    // running compiler/optimizer process (none for the in-process compiler alone)
+    std::chrono::steady_clock::time_point Requested;  // time of the (last coalesced) compile request
+    int64_t                               Detection;  // microseconds from the file write to its detection (-1 if unknown)
+    bool                                  Forced;     // forced recompile (-r); compiles even if the compile cache has the result
+};
+struct PendingCompile {
+    std::chrono::steady_clock::time_point Due;       // time the debounce window ends
+    std::chrono::steady_clock::time_point Requested;
+    int64_t                               Detection;
+    bool                                  Forced;
+};
+static std::deque<fs::path>                                    sCompileQueue;        // pending shaders in request order
+static std::map<fs::path, PendingCompile>                      sCompileQueueDue;     // pending shader -> debounce window and request timing
+static std::map<fs::path, uint64_t>                            sCompileGenerations;  // shader -> number of compile requests so far
+static std::map<fs::path, CompileJob>                          sCompilesInFlight;
+static std::mutex                                              sCompileQueueMutex;
+static std::condition_variable                                 sCompileQueueCondition;
+// notified after every finished compile, for threads waiting for compiles rather than for work (so they never take a wake-up a 
+// worker needed); waited on with sCompileQueueMutex
+static std::condition_variable                                 sCompileFinishedCondition;
+
+// 64-bit FNV-1a hash; pass the previous hash as seed to hash multiple blocks of data as one
+// ----------------------------------------------------------------------------------------
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+uint64_t hashString(const std::string& string, uint64_t hash = 14695981039346656037ull) {
+    // Include the length so consecutive strings can't be shifted into one another ("ab" + "c" vs "a" + "bc")
+    uint64_t length = string.size();
+    return hashBytes(string.data(), string.size(), hashBytes(&length, sizeof(length), hash));
+}
+
+// Read a complete file into memory
+// --------------------------------
+bool readFile(const fs::path& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open())
+        return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+// Check a watched file for modifications; a changed write time, size or inode is confirmed by hashing the contents so touching a
+// file (or saving identical contents) doesn't trigger any work. A file that existed before and is gone now counts as modified.
+// Returns whether the contents changed and updates the entry.
+// ------------------------------------------------------------------------------------------------------------------------------
+bool checkModified(const fs::path& path, FileStat& stat, uint64_t& hash) {
+    FileStat fileStat;
+    if(!statFile(path, fileStat)) {
+        if(stat == FileStat{})
+            return false;
+        stat = FileStat{};
+        hash = 0;
+        return true;
+    }
+    if(fileStat == stat)
+        return false;
+    stat = fileStat;
+    std::string contents;
+    if(!readFile(path, contents))
+        return false;
+    uint64_t contentHash = hashBytes(contents.data(), contents.size());
+    if(contentHash == hash)
+        return false;
+    hash = contentHash;
+    return true;
+}
+bool checkModified(const fs::path& path, ShaderEntry& entry) {
+    return checkModified(path, entry.Stat, entry.Hash);
+}
+
+// Shader stage registry; each stage is recognized by one or more file suffixes (<key>_ext in the .ini, including compound ones 
+// like .vert.glsl) and carries its own extra compiler arguments (<key>_flags) and output file name template (<key>_output). 
+// Suffixes are looked up in a hash table, trying each suffix of a file name from its first dot on (longest first), so the cost
+// of recognizing a file doesn't grow with the number of registered suffixes. Files with a suffix listed in stage_pragma_ext 
+// (e.g. .hlsl) get their stage from a #pragma shader_stage(<stage>) in their source instead
+// -----------------------------------------------------------------------------------------------------------------------------
+struct ShaderStage {
+    const char*              Name;        // stage name as glslc's -fshader-stage and glslangValidator's -S take it
+    const char*              PragmaName;  // stage name as #pragma shader_stage takes it
+    const char*              Key;         // prefix of the stage's .ini keys
+    const char*              DefaultExtensions;
+    std::vector<std::string> Extensions  = {};
+    std::vector<std::string> Flags       = {};
+    std::string              OutputName  = {}; // empty for the default output_name template
+};
+static std::vector<ShaderStage> sShaderStages = {
+    { "vert",  "vertex",       "vs",    ".vert .vert.glsl"   },
+    { "tesc",  "tesscontrol",  "tcs",   ".tesc .tesc.glsl"   },
+    { "tese",  "tesseval",     "tes",   ".tese .tese.glsl"   },
+    { "geom",  "geometry",     "gs",    ".geom .geom.glsl"   },
+    { "frag",  "fragment",     "fs",    ".frag .frag.glsl"   },
+    { "comp",  "compute",      "cs",    ".comp .comp.glsl"   },
+    { "task",  "task",         "task",  ".task .task.glsl"   },
+    { "mesh",  "mesh",         "mesh",  ".mesh .mesh.glsl"   },
+    { "rgen",  "raygen",       "rgen",  ".rgen .rgen.glsl"   },
+    { "rint",  "intersection", "rint",  ".rint .rint.glsl"   },
+    { "rahit", "anyhit",       "rahit", ".rahit .rahit.glsl" },
+    { "rchit", "closesthit",   "rchit", ".rchit .rchit.glsl" },
+    { "rmiss", "miss",         "rmiss", ".rmiss .rmiss.glsl" },
+    { "rcall", "callable",     "rcall", ".rcall .rcall.glsl" },
+};
+static const uint8_t sStageFromSource = 0xFE; // stage is given by the source's #pragma shader_stage
+static const uint8_t sUnknownStage    = 0xFF;
+
+struct ShaderSuffix {
+    std::string Suffix;
+    uint64_t    Hash;
+    uint8_t     Stage; // index in sShaderStages or sStageFromSource
+    bool        HLSL;  // compiled as HLSL (suffix ends in .hlsl)
+};
+static std::vector<ShaderSuffix> sShaderSuffixes;
+static std::vector<int>          sShaderSuffixSlots; // hash table of indices in sShaderSuffixes (-1 if empty); power of two size
+
+// Hash of a suffix, equal for a std::string and the same characters in a (possibly wide) native path
+template<typename Char>
+uint64_t hashSuffix(const Char* characters, size_t count) {
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0; i < count; ++i) {
+        hash ^= static_cast<unsigned char>(characters[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::vector<std::string> splitWords(const std::string& text) {
+    std::vector<std::string> words;
+    std::istringstream stream(text);
+    std::string word;
+    while(stream >> word)
+        words.push_back(word);
+    return words;
+}
+
+void addShaderSuffix(const std::string& suffix, uint8_t stage) {
+    for(ShaderSuffix& registered : sShaderSuffixes) {
+        if(registered.Suffix == suffix) {
+            Log(LogLevel::Warning) << "Shader suffix " << suffix << " is configured for more than one stage, using the last";
+            registered.Stage = stage;
+            return;
+        }
+    }
+    const std::string hlsl = ".hlsl";
+    bool isHLSL = suffix.size() >= hlsl.size() && suffix.compare(suffix.size() - hlsl.size(), hlsl.size(), hlsl) == 0;
+    sShaderSuffixes.push_back({ suffix, hashSuffix(suffix.data(), suffix.size()), stage, isHLSL });
+}
+
+// Set up the stage registry and its suffix table from the .ini's key/value pairs (built-in defaults for keys that aren't set)
+// -------------------------------------------------------------------------------------------------------------------------
+void configureShaderStages(std::map<std::string, std::string>& iniKeyValuePairs) {
+    sShaderSuffixes.clear();
+    for(size_t stage = 0; stage < sShaderStages.size(); ++stage) {
+        ShaderStage& descriptor = sShaderStages[stage];
+        std::string key = descriptor.Key;
+        descriptor.Extensions = splitWords(iniKeyValuePairs[key + "_ext"]);
+        if(descriptor.Extensions.empty())
+            descriptor.Extensions = splitWords(descriptor.DefaultExtensions);
+        descriptor.Flags      = splitWords(iniKeyValuePairs[key + "_flags"]);
+        descriptor.OutputName = iniKeyValuePairs[key + "_output"];
+        for(const std::string& extension : descriptor.Extensions)
+            addShaderSuffix(extension, static_cast<uint8_t>(stage));
+    }
+    auto pragmaExtensions = iniKeyValuePairs.find("stage_pragma_ext");
+    for(const std::string& extension : splitWords(pragmaExtensions != iniKeyValuePairs.end() ? pragmaExtensions->second : ".hlsl"))
+        addShaderSuffix(extension, sStageFromSource);
+
+    size_t size = 64;
+    while(size < sShaderSuffixes.size() * 2)
+        size *= 2;
+    sShaderSuffixSlots.assign(size, -1);
+    for(size_t i = 0; i < sShaderSuffixes.size(); ++i) {
+        size_t slot = sShaderSuffixes[i].Hash & (size - 1);
+        while(sShaderSuffixSlots[slot] >= 0)
+            slot = (slot + 1) & (size - 1);
+        sShaderSuffixSlots[slot] = static_cast<int>(i);
+    }
+}
+
+// Registered suffix matching the end of the file's name (the longest one if several match), or nullptr if it isn't a shader; 
+// compares the path's characters in place as this runs for every file of a scan
+// -----------------------------------------------------------------------------------------------------------------------------
+const ShaderSuffix* findShaderSuffix(const fs::path& p) {
+    if(sShaderSuffixSlots.empty())
+        return nullptr;
+    const fs::path::string_type& path = p.native();
+    size_t nameStart = path.size();
+    while(nameStart > 0 && path[nameStart - 1] != '/' && path[nameStart - 1] != fs::path::preferred_separator)
+        --nameStart;
+    // A suffix has to follow a non-empty file name
+    size_t mask = sShaderSuffixSlots.size() - 1;
+    for(size_t start = nameStart + 1; start < path.size(); ++start) {
+        if(path[start] != '.')
+            continue;
+        uint64_t hash = hashSuffix(path.data() + start, path.size() - start);
+        for(size_t slot = hash & mask; sShaderSuffixSlots[slot] >= 0; slot = (slot + 1) & mask) {
+            const ShaderSuffix& suffix = sShaderSuffixes[sShaderSuffixSlots[slot]];
+            if(suffix.Hash == hash && suffix.Suffix.size() == path.size() - start && 
+               std::equal(suffix.Suffix.begin(), suffix.Suffix.end(), path.begin() + start, [](char a, fs::path::value_type b) { return static_cast<fs::path::value_type>(a) == b; }))
+                return &suffix;
+        }
+    }
+    return nullptr;
+}
+
+bool isShaderFile(const fs::path& p) {
+    return findShaderSuffix(p) != nullptr;
+}
+
+// Index of the stage with the given name (either its compiler or its #pragma shader_stage name), or sUnknownStage
+uint8_t findShaderStage(const std::string& name) {
+    for(size_t stage = 0; stage < sShaderStages.size(); ++stage)
+        if(name == sShaderStages[stage].Name || name == sShaderStages[stage].PragmaName)
+            return static_cast<uint8_t>(stage);
+    return sUnknownStage;
+}
+
+// Stage of a shader from its suffix, or from its #pragma shader_stage(<stage>) when the suffix doesn't determine it; sUnknownStage
+// if neither does
+// -----------------------------------------------------------------------------------------------------------------------------
+uint8_t resolveShaderStage(const fs::path& p, const std::string& source) {
+    const ShaderSuffix* suffix = findShaderSuffix(p);
+    if(!suffix)
+        return sUnknownStage;
+    if(suffix->Stage != sStageFromSource)
+        return suffix->Stage;
+    size_t position = 0;
+    while((position = source.find("#pragma", position)) != std::string::npos) {
+        size_t lineEnd = std::min(source.find('\n', position), source.size());
+        std::string pragma;
+        for(size_t i = position + 7; i < lineEnd; ++i)
+            if(source[i] != ' ' && source[i] != '\t' && source[i] != '\r')
+                pragma += source[i];
+        position = lineEnd;
+        const std::string directive = "shader_stage(";
+        if(pragma.compare(0, directive.size(), directive) == 0 && pragma.back() == ')')
+            return findShaderStage(pragma.substr(directive.size(), pragma.size() - directive.size() - 1));
+    }
+    return sUnknownStage;
+}
+
+// Watch state of all shaders. Paths are interned once: stored back to back in an arena and addressed by a dense ID that an
+// open-addressing hash table (linear probing) maps them to. The per-shader state lives in parallel arrays indexed by that ID,
+// so a scan compares a hash and touches a few contiguous arrays instead of comparing paths down a tree of map nodes. IDs are
+// never handed to another path; a removed shader keeps its ID (marked removed) and gets it back when it reappears
+// ---------------------------------------------------------------------------------------------------------------------------
+typedef uint32_t ShaderId;
+static const ShaderId sNoShader = ~0u;
+enum ShaderStatus : uint8_t { ShaderRemoved, ShaderWatched };
+
+struct ShaderTable {
+    fs::path::string_type PathArena;   // all interned paths (native format) back to back
+    std::vector<size_t>   PathOffsets; // start of each ID's path in the arena; the next ID's start (or the arena end) is its end
+    std::vector<uint64_t> PathHashes;
+    std::vector<ShaderId> Slots;       // hash table of IDs (sNoShader if empty); power of two size, at most half full
+    // per shader state, indexed by ID
+    std::vector<FileStat> Stats;       // state of the file when it was last checked
+    std::vector<uint64_t> Hashes;      // hash of the file's contents when it was last checked
+    std::vector<uint8_t>  Stages;      // index of the shader's stage in sShaderStages (sUnknownStage if unknown)
+    std::vector<uint8_t>  Status;      // ShaderStatus
+    size_t                Watched = 0; // number of shaders with status ShaderWatched
+};
+static ShaderTable sShaders;
+
+uint64_t hashPath(const fs::path::string_type& path) {
+    return hashBytes(path.data(), path.size() * sizeof(fs::path::value_type));
+}
+
+// Interned path of a shader without copying it out of the arena
+std::basic_string_view<fs::path::value_type> shaderPathView(ShaderId id) {
+    size_t begin = sShaders.PathOffsets[id];
+    size_t end   = id + 1 < sShaders.PathOffsets.size() ? sShaders.PathOffsets[id + 1] : sShaders.PathArena.size();
+    return std::basic_string_view<fs::path::value_type>(sShaders.PathArena.data() + begin, end - begin);
+}
+
+fs::path shaderPath(ShaderId id) {
+    return fs::path(fs::path::string_type(shaderPathView(id)));
+}
+
+// Slot holding the path, or the empty slot it would be inserted at
+size_t findShaderSlot(const fs::path::string_type& path, uint64_t hash) {
+    size_t mask = sShaders.Slots.size() - 1;
+    for(size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+        ShaderId id = sShaders.Slots[slot];
+        if(id == sNoShader || (sShaders.PathHashes[id] == hash && shaderPathView(id) == path))
+            return slot;
+    }
+}
+
+void resizeShaderSlots(size_t size) {
+    sShaders.Slots.assign(size, sNoShader);
+    for(ShaderId id = 0; id < sShaders.PathHashes.size(); ++id) {
+        size_t slot = sShaders.PathHashes[id] & (size - 1);
+        while(sShaders.Slots[slot] != sNoShader)
+            slot = (slot + 1) & (size - 1);
+        sShaders.Slots[slot] = id;
+    }
+}
+
+// ID of a watched shader, or sNoShader if the path isn't a watched shader
+ShaderId findShader(const fs::path& p) {
+    if(sShaders.Slots.empty())
+        return sNoShader;
+    const fs::path::string_type& path = p.native();
+    ShaderId id = sShaders.Slots[findShaderSlot(path, hashPath(path))];
+    return id != sNoShader && sShaders.Status[id] == ShaderWatched ? id : sNoShader;
+}
+
+// ID of a path, interning it (with status ShaderRemoved) when it's seen for the first time
+ShaderId internShader(const fs::path& p, uint8_t stage) {
+    if((sShaders.PathHashes.size() + 1) * 2 > sShaders.Slots.size())
+        resizeShaderSlots(std::max<size_t>(1024, sShaders.Slots.size() * 2));
+    const fs::path::string_type& path = p.native();
+    uint64_t hash = hashPath(path);
+    size_t   slot = findShaderSlot(path, hash);
+    if(sShaders.Slots[slot] != sNoShader)
+        return sShaders.Slots[slot];
+
+    ShaderId id = static_cast<ShaderId>(sShaders.PathHashes.size());
+    sShaders.PathOffsets.push_back(sShaders.PathArena.size());
+    sShaders.PathArena += path;
+    sShaders.PathHashes.push_back(hash);
+    sShaders.Stats.push_back(FileStat());
+    sShaders.Hashes.push_back(0);
+    sShaders.Stages.push_back(stage);
+    sShaders.Status.push_back(ShaderRemoved);
+    sShaders.Slots[slot] = id;
+    return id;
+}
+
+// Scan shader source for #include directives and collect all (transitively) included files, resolved relative to the including 
+// file like glslc does
+// -----------------------------------------------------------------------------------------------------------------------------
+void collectIncludes(const fs::path& file, const std::string& source, std::vector<fs::path>& includes) {
+    size_t lineStart = 0;
+    while(lineStart < source.size()) {
+        size_t lineEnd = source.find('\n', lineStart);
+        if(lineEnd == std::string::npos)
+            lineEnd = source.size();
+
+        // Match: [whitespace] # [whitespace] include [whitespace] "file" or <file>
+        size_t i = source.find_first_not_of(" \t", lineStart);
+        if(i < lineEnd && source[i] == '#') {
+            i = source.find_first_not_of(" \t", i + 1);
+            if(i < lineEnd && source.compare(i, 7, "include") == 0) {
+                i = source.find_first_not_of(" \t", i + 7);
+                if(i < lineEnd && (source[i] == '"' || source[i] == '<')) {
+                    size_t nameEnd = source.find(source[i] == '"' ? '"' : '>', i + 1);
+                    if(nameEnd < lineEnd) {
+                        fs::path includePath = (file.parent_path() / source.substr(i + 1, nameEnd - i - 1)).lexically_normal();
+                        // Missing includes are recorded too, so the shader gets recompiled once the file is (re)created
+                        std::string includeSource;
+                        if(std::find(includes.begin(), includes.end(), includePath) == includes.end()) {
+                            includes.push_back(includePath);
+                            if(readFile(includePath, includeSource))
+                                collectIncludes(includePath, includeSource, includes);
+                        }
+                    }
+                }
+            }
+        }
+        lineStart = lineEnd + 1;
+    }
+}
+
+// Include dependency graph; tracks the files each shader (transitively) includes so a modified include only recompiles the 
+// shaders that depend on it
+// -------------------------------------------------------------------------------------------------------------------------
+static std::mutex                               sDependencyMutex;
+static std::map<fs::path, std::vector<fs::path>> sShaderIncludes;    // shader -> all files it includes
+static std::map<fs::path, std::set<fs::path>>    sIncludeDependents; // included file -> all shaders including it
+static std::map<fs::path, ShaderEntry>           sIncludeEntries;    // watch state of each included file
+#ifdef __linux__
+static int                                       sInotifyFd = -1;
+static std::map<int, fs::path>                   sInotifyWatches;    // inotify watch descriptor -> watched directory
+static std::set<fs::path>                        sInotifyWatchedDirectories;
+
+// IN_CLOSE_WRITE catches in-place saves, IN_MOVED_TO catches editors that save to a temp file and rename it over the original, 
+// the others keep the directory listings of the source tree up-to-date
+static const uint32_t                            sInotifyWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+
+// Start receiving inotify events for a directory (includes can live outside of the shader directory); call with sDependencyMutex locked
+void addInotifyWatch(const fs::path& directory) {
+    if(sInotifyFd < 0 || !sInotifyWatchedDirectories.insert(directory).second)
+        return;
+    int watchDescriptor = inotify_add_watch(sInotifyFd, directory.c_str(), sInotifyWatchMask);
+    if(watchDescriptor >= 0) {
+        sInotifyWatches[watchDescriptor] = directory;
+    } else if(errno == ENOSPC) {
+        Log(LogLevel::Warning) << "Failed to watch " << directory.string() << ": inotify watch limit reached (raise fs.inotify.max_user_watches)";
+    }
+}
+#endif
+
+// Replace the recorded includes of a shader
+void updateDependencies(const fs::path& shader, const std::vector<fs::path>& includes) {
+    std::lock_guard<std::mutex> lock(sDependencyMutex);
+    std::vector<fs::path>& shaderIncludes = sShaderIncludes[shader];
+    for(const fs::path& include : shaderIncludes) {
+        auto dependents = sIncludeDependents.find(include);
+        if(dependents != sIncludeDependents.end()) {
+            dependents->second.erase(shader);
+            if(dependents->second.empty()) {
+                sIncludeDependents.erase(dependents);
+                sIncludeEntries.erase(include);
+            }
+        }
+    }
+    shaderIncludes = includes;
+    for(const fs::path& include : includes) {
+        if(sIncludeDependents[include].insert(shader).second && sIncludeEntries.find(include) == sIncludeEntries.end()) {
+            ShaderEntry& entry = sIncludeEntries[include];
+            std::string contents;
+            statFile(include, entry.Stat);
+            readFile(include, contents);
+            entry.Hash = hashBytes(contents.data(), contents.size());
+#ifdef __linux__
+            addInotifyWatch(include.parent_path());
+#endif
+        }
+    }
+}
+
+// Returns all shaders that include the given file (empty if it isn't included anywhere)
+std::vector<fs::path> getDependents(const fs::path& include) {
+    std::lock_guard<std::mutex> lock(sDependencyMutex);
+    auto dependents = sIncludeDependents.find(include);
+    if(dependents == sIncludeDependents.end())
+        return {};
+    return std::vector<fs::path>(dependents->second.begin(), dependents->second.end());
+}
+
+// Run a program directly (without a shell in between) and capture its stdout and stderr; returns the program's exit code
+// ----------------------------------------------------------------------------------------------------------------------
+#ifdef __linux__
+// Child side of runProcess; ties the process to ShaderAssist's lifetime and then becomes the actual program. The compilers run in
+// their own process group, so without this they'd survive ShaderAssist being killed (a signal to its group no longer reaches them)
+int runChild(pid_t parent, char** argv) {
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if(getppid() != parent)
+        return 127; // ShaderAssist died before the death signal was set up
+    execvp(argv[0], argv);
+    std::cout << "failed to start " << argv[0] << ": " << strerror(errno) << std::endl;
+    return 127;
+}
+#endif
+
+int runProcess(const std::vector<std::string>& arguments, std::string& output, ProcessHandle* process = nullptr, int64_t* cpuMicroseconds = nullptr) {
+#if defined __linux__ || defined __unix__
+    std::vector<char*> argv;
+#ifdef __linux__
+    // Started through runChild (this executable with --run-child <pid>) so the process gets killed when ShaderAssist dies
+    std::string parent = std::to_string(getpid());
+    argv = { const_cast<char*>("/proc/self/exe"), const_cast<char*>("--run-child"), const_cast<char*>(parent.c_str()) };
+#endif
+    for(const std::string& argument : arguments)
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    argv.push_back(nullptr);
+
+    // Close-on-exec so compilers spawned concurrently from other workers don't inherit (and keep open) this pipe
+    int outputPipe[2];
+    if(pipe2(outputPipe, O_CLOEXEC) != 0) {
+        output = "failed to create output pipe";
+        return -1;
+    }
+    posix_spawn_file_actions_t fileActions;
+    posix_spawn_file_actions_init(&fileActions);
+    posix_spawn_file_actions_adddup2(&fileActions, outputPipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fileActions, outputPipe[1], STDERR_FILENO);
+    posix_spawn_file_actions_addopen(&fileActions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+    // Own process group so cancelling also terminates anything the compiler (or a wrapper script) spawned itself
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], &fileActions, &attributes, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&fileActions);
+    posix_spawnattr_destroy(&attributes);
+    close(outputPipe[1]);
+    if(error != 0) {
+        close(outputPipe[0]);
+        output = "failed to start " + arguments[0] + ": " + strerror(error);
+        return -1;
+    }
+    if(process) {
+        std::lock_guard<std::mutex> lock(process->Mutex);
+        process->Pid = pid;
+        if(process->Cancelled)
+            kill(-pid, SIGKILL);
+    }
+
+    char buffer[4096];
+    ssize_t length;
+    while((length = read(outputPipe[0], buffer, sizeof(buffer))) != 0) {
+        if(length < 0) {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+        output.append(buffer, length);
+    }
+    close(outputPipe[0]);
+
+    // Wait for the process to exit without reaping it first, so the pid can't be reused while another thread may still signal it
+    if(process) {
+        siginfo_t info;
+        while(waitid(P_PID, pid, &info, WEXITED | WNOWAIT) < 0 && errno == EINTR);
+        std::lock_guard<std::mutex> lock(process->Mutex);
+        process->Pid = -1;
+    }
+    // Reap with wait4 to also get the CPU time (user + system) the process used
+    int status;
+    struct rusage usage;
+    while(wait4(pid, &status, 0, &usage) < 0 && errno == EINTR);
+    if(cpuMicroseconds)
+        *cpuMicroseconds = (static_cast<int64_t>(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#else
+    // No posix_spawn available; fall back to the shell, quoting each argument so paths with spaces survive. The process can't be
+    // cancelled and its CPU time isn't measured here
+    (void)process;
+    if(cpuMicroseconds)
+        *cpuMicroseconds = 0;
+    std::string command = "";
+    for(const std::string& argument : arguments)
+        command += "\"" + argument + "\" ";
+    command += "2>&1";
+    output = "";
+    #ifdef _WIN32
+        // cmd.exe strips the first and last quote of the command line when it starts with a quote
+        command = "\"" + command + "\"";
+        FILE* pipe = _popen(command.c_str(), "r");
+    #else
+        FILE* pipe = popen(command.c_str(), "r");
+    #endif
+    if(!pipe) {
+        output = "failed to start " + arguments[0] + ": " + strerror(errno);
+        return -1;
+    }
+    char buffer[4096];
+    size_t length;
+    while((length = fread(buffer, 1, sizeof(buffer), pipe)) != 0)
+        output.append(buffer, length);
+    #ifdef _WIN32
+        return _pclose(pipe);
+    #else
+        return pclose(pipe);
+    #endif
+#endif
+}
+
+#ifdef SHADERASSIST_SHADERC
+// In-process shaderc engine; the compiler and its options (including the built-in resource tables) are set up once and shared 
+// by all compile workers (shaderc compilers are safe to use from multiple threads concurrently)
+// --------------------------------------------------------------------------------------------------------------------------
+static shaderc_compiler_t        sShadercCompiler = nullptr;
+static shaderc_compile_options_t sShadercOptions  = nullptr;
+
+// Resolve #include directives for shaderc (glslc does this for us when compiling through the external process)
+struct ShadercInclude {
+    std::string            Name;
+    std::string            Content;
+    shaderc_include_result Result;
+};
+shaderc_include_result* shadercResolveInclude(void* /*userData*/, const char* requestedSource, int type, const char* requestingSource, size_t /*includeDepth*/) {
+    ShadercInclude* include = new ShadercInclude;
+    fs::path path = fs::path(requestingSource).parent_path() / requestedSource;
+    if(type == shaderc_include_type_standard && !fs::exists(path))
+        path = requestedSource;
+    std::ifstream file(path, std::ios::binary);
+    if(file.is_open()) {
+        include->Name    = path.string();
+        include->Content = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    } else {
+        // An empty source name tells shaderc the include failed, content then holds the error message
+        include->Content = "unable to open include file " + path.string();
+    }
+    include->Result = { include->Name.c_str(), include->Name.size(), include->Content.c_str(), include->Content.size(), include };
+    return &include->Result;
+}
+void shadercReleaseInclude(void* /*userData*/, shaderc_include_result* result) {
+    delete static_cast<ShadercInclude*>(result->user_data);
+}
+
+bool initInProcessCompiler() {
+    sShadercCompiler = shaderc_compiler_initialize();
+    sShadercOptions  = shaderc_compile_options_initialize();
+    if(!sShadercCompiler || !sShadercOptions)
+        return false;
+    shaderc_compile_options_set_include_callbacks(sShadercOptions, shadercResolveInclude, shadercReleaseInclude, nullptr);
+    return true;
+}
+
+void releaseInProcessCompiler() {
+    if(sShadercOptions)
+        shaderc_compile_options_release(sShadercOptions);
+    if(sShadercCompiler)
+        shaderc_compiler_release(sShadercCompiler);
+}
+
+// Compile a shader through shaderc and write the SPIR-V to outputPath; returns 0 on success like an external compiler would
+// (stage indexes sShaderStages, anything else leaves the stage to the source's #pragma shader_stage)
+int compileShaderInProcess(const std::string& inputPath, uint8_t stage, bool isHLSL, const std::string& source, const std::string& outputPath, std::string& output) {
+    static const shaderc_shader_kind kinds[] = {
+        shaderc_glsl_default_vertex_shader,     shaderc_glsl_default_tess_control_shader, shaderc_glsl_default_tess_evaluation_shader,
+        shaderc_glsl_default_geometry_shader,   shaderc_glsl_default_fragment_shader,     shaderc_glsl_default_compute_shader,
+        shaderc_glsl_default_task_shader,       shaderc_glsl_default_mesh_shader,         shaderc_glsl_default_raygen_shader,
+        shaderc_glsl_default_intersection_shader, shaderc_glsl_default_anyhit_shader,     shaderc_glsl_default_closesthit_shader,
+        shaderc_glsl_default_miss_shader,       shaderc_glsl_default_callable_shader,
+    };
+    shaderc_shader_kind kind = stage < sizeof(kinds) / sizeof(kinds[0]) ? kinds[stage] : shaderc_glsl_infer_from_source;
+
+    // The options are shared by all workers; HLSL compiles get their own copy with the source language changed
+    shaderc_compile_options_t options = sShadercOptions;
+    if(isHLSL) {
+        options = shaderc_compile_options_clone(sShadercOptions);
+        shaderc_compile_options_set_source_language(options, shaderc_source_language_hlsl);
+    }
+    shaderc_compilation_result_t result = shaderc_compile_into_spv(sShadercCompiler, source.c_str(), source.size(), kind, inputPath.c_str(), "main", options);
+    if(isHLSL)
+        shaderc_compile_options_release(options);
+    output = shaderc_result_get_error_message(result);
+    int exitCode = 1;
+    if(shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success) {
+        std::ofstream spirv(outputPath, std::ios::binary | std::ios::trunc);
+        spirv.write(shaderc_result_get_bytes(result), shaderc_result_get_length(result));
+        if(spirv.good()) {
+            exitCode = 0;
+        } else {
+            output = "unable to write " + outputPath;
+        }
+    }
+    shaderc_result_release(result);
+    return exitCode;
+}
+#endif
+
+// Watch-state manifest; records the state of each source file (shaders and their includes) as of its last successful compile and
+// is stored in the output directory, so a restart only compiles the files that changed while ShaderAssist wasn't running
+// --------------------------------------------------------------------------------------------------------------------------------
+struct FileState {
+    int64_t  WriteTime; // full precision last write time as statFile reports it (nanoseconds on POSIX, file clock ticks elsewhere)
+    uint64_t Size;
+    uint64_t Hash;      // hash of the file's contents
+};
+static std::mutex                    sManifestMutex;
+static std::map<fs::path, FileState> sManifest;
+static bool                          sManifestLoaded = false;
+static bool                          sManifestDirty  = false;
+
+FileState getFileState(const fs::path& path, const std::string& contents) {
+    FileStat fileStat = {};
+    statFile(path, fileStat);
+    return { fileStat.WriteTime, contents.size(), hashBytes(contents.data(), contents.size()) };
+}
+
+std::string getManifestPath() {
+    return config.SPIRVOutputPath + "/.shaderassist_manifest";
+}
+
+void loadManifest() {
+    std::ifstream file(getManifestPath());
+    if(!file.is_open())
+        return;
+    std::lock_guard<std::mutex> lock(sManifestMutex);
+    std::string line;
+    while(std::getline(file, line)) {
+        // Each line: <content hash> <size> <write time> <path>
+        unsigned long long hash, size;
+        long long writeTime;
+        int pathStart = 0;
+        if(line[0] != '#' && sscanf(line.c_str(), "%llx %llu %lld %n", &hash, &size, &writeTime, &pathStart) == 3 && pathStart > 0)
+            sManifest[line.substr(pathStart)] = { static_cast<int64_t>(writeTime), size, hash };
+    }
+    sManifestLoaded = true;
+}
+
+// Write the manifest if anything changed since it was last written; written to a temporary file first so a crash never leaves a 
+// truncated manifest behind
+void saveManifest() {
+    std::lock_guard<std::mutex> lock(sManifestMutex);
+    if(!sManifestDirty)
+        return;
+    std::string path = getManifestPath();
+    {
+        std::ofstream file(path + ".tmp", std::ios::trunc);
+        file << "# ShaderAssist watch-state manifest: <content hash> <size> <write time> <path>\n";
+        char fields[64];
+        for(auto& entry : sManifest) {
+            snprintf(fields, sizeof(fields), "%016llx %llu %lld ", static_cast<unsigned long long>(entry.second.Hash), 
+                     static_cast<unsigned long long>(entry.second.Size), static_cast<long long>(entry.second.WriteTime));
+            file << fields << entry.first.string() << "\n";
+        }
+        if(!file.good())
+            return;
+    }
+    std::error_code error;
+    fs::rename(path + ".tmp", path, error);
+    sManifestDirty = false;
+}
+
+void recordManifest(const fs::path& path, const FileState& state) {
+    std::lock_guard<std::mutex> lock(sManifestMutex);
+    sManifest[path] = state;
+    sManifestDirty  = true;
+}
+void forgetManifest(const fs::path& path) {
+    std::lock_guard<std::mutex> lock(sManifestMutex);
+    if(sManifest.erase(path) != 0)
+        sManifestDirty = true;
+}
+
+// Returns whether a file is unchanged since it was recorded in the manifest; the contents are only hashed when the write time 
+// differs (e.g. a checkout that rewrote the file with identical contents)
+bool matchesManifest(const fs::path& path) {
+    FileState recorded;
+    {
+        std::lock_guard<std::mutex> lock(sManifestMutex);
+        auto entry = sManifest.find(path);
+        if(entry == sManifest.end())
+            return false;
+        recorded = entry->second;
+    }
+    // Missing includes are recorded with a zero write time; one that's still missing is unchanged
+    FileStat fileStat;
+    if(!statFile(path, fileStat))
+        return recorded.WriteTime == 0;
+    if(fileStat.Size != recorded.Size)
+        return false;
+    if(fileStat.WriteTime == recorded.WriteTime)
+        return true;
+    std::string contents;
+    if(!readFile(path, contents) || hashBytes(contents.data(), contents.size()) != recorded.Hash)
+        return false;
+    // Same contents; remember the new write time so the file doesn't need to be hashed again next startup
+    recordManifest(path, getFileState(path, contents));
+    return true;
+}
+
+// Compile cache; compiled SPIR-V is stored by a hash of everything that determines the compiler's output (the shader source, the
+// contents of all its includes, the compiler and its version and the compiler arguments)
+// -------------------------------------------------------------------------------------------------------------------------------
+// identifies the active compiler (path and version output), determined once on startup
+static std::string sCompilerIdentity;
+
+void initCompileCache() {
+    if(config.CompileCachePath.empty())
+        return;
+    std::error_code error;
+    fs::create_directories(config.CompileCachePath, error);
+    if(error) {
+        Log(LogLevel::Warning) << "Failed to create compile cache directory " << config.CompileCachePath << ", compile cache disabled";
+        config.CompileCachePath = "";
+        return;
+    }
+    if(config.UseInProcessCompiler) {
+#ifdef SHADERASSIST_SHADERC
+        // The SPIR-V version and revision the library generates change with shaderc releases
+        unsigned int version = 0, revision = 0;
+        shaderc_get_spv_version(&version, &revision);
+        sCompilerIdentity = "shaderc (in-process)\nSPIR-V " + std::to_string(version) + " revision " + std::to_string(revision);
+#endif
+    } else {
+        // The version output changes with each SDK release, which invalidates everything compiled with the older compiler
+        std::string compilerPath = config.UseGoogleSPIRV ? config.GLSLCPath : config.GLSLLangValidatorPath;
+        std::string versionOutput;
+        runProcess({ compilerPath, "--version" }, versionOutput);
+        sCompilerIdentity = compilerPath + "\n" + versionOutput;
+    }
+}
+
+// Cache entries (of the compile cache and the optimizer cache) are named by their hash as 16 hex digits
+std::string formatCacheKey(uint64_t hash) {
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return key;
+}
+
+// Store a copy of a file as a cache entry; copies to a temporary file first so other workers never restore a partially written entry
+void storeFileAtomically(const std::string& source, const std::string& destination) {
+    std::error_code error;
+    std::string temporaryPath = destination + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    if(fs::copy_file(source, temporaryPath, fs::copy_options::overwrite_existing, error))
+        fs::rename(temporaryPath, destination, error);
+    if(error)
+        fs::remove(temporaryPath, error);
+}
+
+std::string compileCacheKey(const std::vector<std::string>& arguments, const FileState& sourceState, const std::vector<fs::path>& includes, 
+                            const std::vector<FileState>& includeStates) {
+    uint64_t hash = hashString(sCompilerIdentity);
+    for(const std::string& argument : arguments)
+        hash = hashString(argument, hash);
+    hash = hashBytes(&sourceState.Hash, sizeof(sourceState.Hash), hash);
+    for(size_t i = 0; i < includes.size(); ++i) {
+        hash = hashString(includes[i].string(), hash);
+        hash = hashBytes(&includeStates[i].Hash, sizeof(includeStates[i].Hash), hash);
+    }
+    return formatCacheKey(hash);
+}
+
+// SPIR-V optimizer (spirv_opt_path); runs spirv-opt with the .ini-specified passes over each compiled shader before it's moved 
+// into place. Optimized modules are cached (spirv_opt_cache_path) keyed by the hash of the unoptimized SPIR-V (and of the 
+// optimizer and its passes), so a shader whose SPIR-V didn't change (restored from the compile cache, or a change that didn't
+// affect the generated code) is never optimized again
+// -----------------------------------------------------------------------------------------------------------------------------
+static std::string sOptimizerIdentity;
+
+void initOptimizer() {
+    if(config.SPIRVOptPath.empty())
+        return;
+    std::string versionOutput;
+    if(runProcess({ config.SPIRVOptPath, "--version" }, versionOutput) != 0) {
+        Log(LogLevel::Warning) << "Failed to run the SPIR-V optimizer " << config.SPIRVOptPath << ", optimization disabled";
+        config.SPIRVOptPath = "";
+        return;
+    }
+    sOptimizerIdentity = config.SPIRVOptPath + "\n" + versionOutput;
+
+    // Cache independently of the compile cache, so optimizing stays incremental with the compile cache disabled
+    if(config.SPIRVOptCachePath.empty())
+        config.SPIRVOptCachePath = config.CompileCachePath.empty() ? (sSPIRVOutputRoot / ".optcache").string() : config.CompileCachePath;
+    std::error_code error;
+    fs::create_directories(config.SPIRVOptCachePath, error);
+    if(error) {
+        Log(LogLevel::Warning) << "Failed to create optimizer cache directory " << config.SPIRVOptCachePath << ", optimizer cache disabled";
+        config.SPIRVOptCachePath = "";
+    }
+}
+
+// Optimize the SPIR-V file at path in place; returns false (with the optimizer's output) if the optimizer failed
+bool optimizeSPIRV(const std::string& path, ProcessHandle* process, std::string& output, bool& cached) {
+    cached = false;
+    std::string spirv;
+    if(!readFile(path, spirv)) {
+        output = "unable to read " + path;
+        return false;
+    }
+    std::vector<std::string> passes = splitWords(config.SPIRVOptPasses);
+    std::string cachePath;
+    std::error_code error;
+    if(!config.SPIRVOptCachePath.empty()) {
+        uint64_t hash = hashString(sOptimizerIdentity);
+        for(const std::string& pass : passes)
+            hash = hashString(pass, hash);
+        hash = hashString(spirv, hash);
+        cachePath = config.SPIRVOptCachePath + "/" + formatCacheKey(hash) + ".opt" + config.SPIRVExt;
+        if(fs::copy_file(cachePath, path, fs::copy_options::overwrite_existing, error)) {
+            cached = true;
+            return true;
+        }
+    }
+
+    std::string optimizedPath = path + ".opt";
+    std::vector<std::string> arguments = { config.SPIRVOptPath };
+    arguments.insert(arguments.end(), passes.begin(), passes.end());
+    arguments.insert(arguments.end(), { path, "-o", optimizedPath });
+    if(runProcess(arguments, output, process) != 0) {
+        fs::remove(optimizedPath, error);
+        return false;
+    }
+    if(!cachePath.empty())
+        storeFileAtomically(optimizedPath, cachePath);
+    fs::rename(optimizedPath, path, error);
+    if(error)
+        output = "unable to write " + path;
+    return !error;
+}
+
+// SPIR-V reflection; parses the instruction stream of a compiled shader in a single pass and writes its pipeline layout relevant 
+// metadata (entry points, descriptor bindings, push constants, vertex inputs and workgroup size) as JSON next to the .spv file
+// ------------------------------------------------------------------------------------------------------------------------------
+// Read-only view of a file's contents; memory-mapped where available
+struct MappedFile {
+    const uint32_t*       Data = nullptr;
+    size_t                Size = 0; // in bytes
+#if defined __linux__ || defined __unix__
+    void*                 Mapping = nullptr;
+#else
+    std::vector<uint32_t> Buffer;
+#endif
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+#if defined __linux__ || defined __unix__
+        if(Mapping)
+            munmap(Mapping, Size);
+#endif
+    }
+};
+
+bool mapFile(const std::string& path, MappedFile& file) {
+#if defined __linux__ || defined __unix__
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+    struct stat status;
+    if(fstat(fd, &status) != 0 || status.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return false;
+    file.Mapping = mapping;
+    file.Data    = static_cast<const uint32_t*>(mapping);
+    file.Size    = status.st_size;
+    return true;
+#else
+    std::string contents;
+    if(!readFile(path, contents) || contents.empty())
+        return false;
+    file.Buffer.resize((contents.size() + 3) / 4);
+    memcpy(file.Buffer.data(), contents.data(), contents.size());
+    file.Data = file.Buffer.data();
+    file.Size = contents.size();
+    return true;
+#endif
+}
+
+// Everything recorded about a single SPIR-V result id
+struct SpirvId {
+    const uint32_t*       Instruction  = nullptr; // instruction defining the id (types, constants and variables)
+    std::string           Name;
+    uint32_t              Set          = ~0u;
+    uint32_t              Binding      = ~0u;
+    uint32_t              Location     = ~0u;
+    uint32_t              ArrayStride  = 0;
+    bool                  BuiltIn      = false;
+    bool                  Block        = false;
+    bool                  BufferBlock  = false;
+    std::vector<uint32_t> MemberOffsets;       // structs only
+    std::vector<uint32_t> MemberMatrixStrides; // structs only
+};
+
+// Decode a SPIR-V literal string (nul-terminated, packed into words)
+std::string spirvString(const uint32_t* words, uint32_t wordCount) {
+    const char* characters = reinterpret_cast<const char*>(words);
+    return std::string(characters, strnlen(characters, wordCount * 4));
+}
+
+// Value of an integer constant (0 for anything else)
+uint32_t spirvConstant(const std::vector<SpirvId>& ids, uint32_t id) {
+    if(id >= ids.size() || !ids[id].Instruction)
+        return 0;
+    const uint32_t* instruction = ids[id].Instruction;
+    uint32_t opcode = instruction[0] & 0xFFFF;
+    // OpConstant or OpSpecConstant (default value)
+    return (opcode == 43 || opcode == 50) && (instruction[0] >> 16) > 3 ? instruction[3] : 0;
+}
+
+// Types nest this deep at most; a (malformed) module whose types refer back to themselves would otherwise recurse forever
+static const uint32_t sSpirvMaxTypeDepth = 64;
+
+// Size in bytes of a type as laid out in a buffer block (explicit offsets and strides come from the decorations)
+uint32_t spirvTypeSize(const std::vector<SpirvId>& ids, uint32_t id, uint32_t matrixStride = 0, uint32_t depth = 0) {
+    if(id >= ids.size() || !ids[id].Instruction || depth > sSpirvMaxTypeDepth)
+        return 0;
+    const uint32_t* instruction = ids[id].Instruction;
+    switch(instruction[0] & 0xFFFF) {
+        case 20: return 4;                                                    // OpTypeBool
+        case 21: case 22: return instruction[2] / 8;                          // OpTypeInt, OpTypeFloat
+        case 23: return instruction[3] * spirvTypeSize(ids, instruction[2], 0, depth + 1);  // OpTypeVector
+        case 24: return instruction[3] * (matrixStride ? matrixStride : spirvTypeSize(ids, instruction[2], 0, depth + 1)); // OpTypeMatrix
+        case 28: return spirvConstant(ids, instruction[3]) * (ids[id].ArrayStride ? ids[id].ArrayStride : spirvTypeSize(ids, instruction[2], 0, depth + 1)); // OpTypeArray
+        case 30: { // OpTypeStruct
+            uint32_t size    = 0;
+            uint32_t members = (instruction[0] >> 16) - 2;
+            const SpirvId& type = ids[id];
+            for(uint32_t i = 0; i < members; ++i) {
+                uint32_t offset = i < type.MemberOffsets.size() ? type.MemberOffsets[i] : size;
+                uint32_t stride = i < type.MemberMatrixStrides.size() ? type.MemberMatrixStrides[i] : 0;
+                size = std::max(size, offset + spirvTypeSize(ids, instruction[2 + i], stride, depth + 1));
+            }
+            return size;
+        }
+        default: return 0;
+    }
+}
+
+// GLSL name of a vertex input type (float, vec3, ivec2, uvec4, mat4, ...)
+std::string spirvTypeName(const std::vector<SpirvId>& ids, uint32_t id, uint32_t depth = 0) {
+    if(id >= ids.size() || !ids[id].Instruction || depth > sSpirvMaxTypeDepth)
+        return "unknown";
+    const uint32_t* instruction = ids[id].Instruction;
+    switch(instruction[0] & 0xFFFF) {
+        case 20: return "bool";
+        case 21: return instruction[3] ? "int" : "uint";
+        case 22: return instruction[2] == 64 ? "double" : "float";
+        case 23: {
+            std::string component = spirvTypeName(ids, instruction[2], depth + 1);
+            std::string prefix    = component == "float" ? "" : component == "double" ? "d" : component == "int" ? "i" : component == "uint" ? "u" : "b";
+            return prefix + "vec" + std::to_string(instruction[3]);
+        }
+        case 24: { // OpTypeMatrix: GLSL names it by columns x rows (the component count of its column vectors), e.g. mat3x4, dmat4
+            const SpirvId* column = instruction[2] < ids.size() ? &ids[instruction[2]] : nullptr;
+            uint32_t rows = column && column->Instruction && (column->Instruction[0] & 0xFFFF) == 23 ? column->Instruction[3] : 0;
+            std::string prefix = spirvTypeName(ids, instruction[2], depth + 1).compare(0, 4, "dvec") == 0 ? "d" : "";
+            return prefix + "mat" + std::to_string(instruction[3]) + (rows == instruction[3] ? "" : "x" + std::to_string(rows));
+        }
+        case 28: return spirvTypeName(ids, instruction[2], depth + 1) + "[" + std::to_string(spirvConstant(ids, instruction[3])) + "]";
+        default: return "unknown";
+    }
+}
+
+// Minimum word count of the instructions whose operands the reflection reads, so it never reads past a (malformed) instruction
+uint32_t spirvMinimumLength(uint32_t opcode) {
+    switch(opcode) {
+        case 25: return 9; // OpTypeImage (up to its Sampled operand)
+        case 21: case 23: case 24: case 28: case 32: case 43: case 50: case 59: return 4;
+        case 22: case 29: return 3; // OpTypeFloat, OpTypeRuntimeArray
+        default: return 2;
+    }
+}
+
+// Vulkan descriptor type of a resource variable's (pointed to) type
+std::string spirvDescriptorType(const std::vector<SpirvId>& ids, uint32_t typeId, uint32_t storageClass) {
+    if(typeId >= ids.size() || !ids[typeId].Instruction)
+        return "unknown";
+    const uint32_t* instruction = ids[typeId].Instruction;
+    switch(instruction[0] & 0xFFFF) {
+        case 25: // OpTypeImage: Dim (Buffer = 5) and Sampled (1 = sampled, 2 = storage)
+            if(instruction[3] == 5)
+                return instruction[7] == 2 ? "storage_texel_buffer" : "uniform_texel_buffer";
+            if(instruction[3] == 6)
+                return "input_attachment"; // Dim SubpassData
+            return instruction[7] == 2 ? "storage_image" : "sampled_image";
+        case 26:   return "sampler";                 // OpTypeSampler
+        case 27:   return "combined_image_sampler";  // OpTypeSampledImage
+        case 5341: return "acceleration_structure";  // OpTypeAccelerationStructureKHR
+        case 30:   // OpTypeStruct
+            if(storageClass == 12 || ids[typeId].BufferBlock) // StorageBuffer storage class or legacy BufferBlock decoration
+                return "storage_buffer";
+            return "uniform_buffer";
+        default:   return "unknown";
+    }
+}
+
+// Name of a SPIR-V execution model
+std::string spirvStageName(uint32_t model) {
+    switch(model) {
+        case 0:    return "vertex";
+        case 1:    return "tessellation_control";
+        case 2:    return "tessellation_evaluation";
+        case 3:    return "geometry";
+        case 4:    return "fragment";
+        case 5:    return "compute";
+        case 5267: case 5364: return "task";
+        case 5268: case 5365: return "mesh";
+        case 5313: return "ray_generation";
+        case 5314: return "intersection";
+        case 5315: return "any_hit";
+        case 5316: return "closest_hit";
+        case 5317: return "miss";
+        case 5318: return "callable";
+        default:   return "execution_model_" + std::to_string(model);
+    }
+}
+
+void generateMetaData(const std::string& spirvPath) {
+    MappedFile file;
+    if(!mapFile(spirvPath, file) || file.Size < 20 || file.Data[0] != 0x07230203) {
+        Log(LogLevel::Warning) << "- Failed to generate metadata: " << spirvPath << " is not a valid SPIR-V module";
+        return;
+    }
+    const uint32_t* words     = file.Data;
+    size_t          wordCount = file.Size / 4;
+    // Header: magic, version, generator, id bound, schema; every id takes an instruction of at least two words, so a bound beyond
+    // the module's size is bogus
+    std::vector<SpirvId> ids(std::min<size_t>(words[3], wordCount));
+
+    struct EntryPoint { uint32_t Model; uint32_t Id; std::string Name; };
+    std::vector<EntryPoint> entryPoints;
+    std::vector<uint32_t>   variables;
+    uint32_t workgroupSize[3]   = { 0, 0, 0 };
+    uint32_t workgroupSizeIds[3] = { 0, 0, 0 };
+
+    // Single pass over all instructions
+    for(size_t i = 5; i < wordCount; ) {
+        const uint32_t* instruction = words + i;
+        uint32_t length = instruction[0] >> 16;
+        uint32_t opcode = instruction[0] & 0xFFFF;
+        if(length == 0 || i + length > wordCount)
+            break; // malformed
+        i += length;
+
+        auto id = [&](uint32_t operand) -> SpirvId* {
+            return operand < length && instruction[operand] < ids.size() ? &ids[instruction[operand]] : nullptr;
+        };
+        switch(opcode) {
+            case 5: // OpName
+                if(SpirvId* target = id(1))
+                    target->Name = spirvString(instruction + 2, length - 2);
+                break;
+            case 15: // OpEntryPoint
+                if(length > 3)
+                    entryPoints.push_back({ instruction[1], instruction[2], spirvString(instruction + 3, length - 3) });
+                break;
+            case 16: // OpExecutionMode LocalSize
+                if(length >= 6 && instruction[2] == 17)
+                    std::copy(instruction + 3, instruction + 6, workgroupSize);
+                break;
+            case 331: // OpExecutionModeId LocalSizeId
+                if(length >= 6 && instruction[2] == 38)
+                    std::copy(instruction + 3, instruction + 6, workgroupSizeIds);
+                break;
+            case 71: // OpDecorate
+                if(SpirvId* target = id(1)) {
+                    uint32_t value = length > 3 ? instruction[3] : 0;
+                    switch(length > 2 ? instruction[2] : ~0u) {
+                        case 2:  target->Block       = true;  break;
+                        case 3:  target->BufferBlock = true;  break;
+                        case 6:  target->ArrayStride = value; break;
+                        case 11: target->BuiltIn     = true;  break;
+                        case 30: target->Location    = value; break;
+                        case 33: target->Binding     = value; break;
+                        case 34: target->Set         = value; break;
+                    }
+                }
+                break;
+            case 72: // OpMemberDecorate Offset/MatrixStride
+                if(SpirvId* target = id(1)) {
+                    if(length < 5)
+                        break;
+                    std::vector<uint32_t>* member = instruction[3] == 35 ? &target->MemberOffsets : instruction[3] == 7 ? &target->MemberMatrixStrides : nullptr;
+                    if(member) {
+                        if(member->size() <= instruction[2])
+                            member->resize(instruction[2] + 1, 0);
+                        (*member)[instruction[2]] = instruction[4];
+                    }
+                }
+                break;
+            case 20: case 21: case 22: case 23: case 24: case 25: case 26: case 27: case 29: case 30: case 32: case 5341:
+                // Types: OpTypeBool .. OpTypeStruct, OpTypePointer, OpTypeAccelerationStructureKHR (result id is the first operand)
+                if(length < spirvMinimumLength(opcode))
+                    break;
+                if(SpirvId* result = id(1))
+                    result->Instruction = instruction;
+                break;
+            case 28: case 43: case 50: case 59:
+                // OpTypeArray (result id first), OpConstant, OpSpecConstant and OpVariable (result type first, then result id)
+                if(length < spirvMinimumLength(opcode))
+                    break;
+                if(SpirvId* result = id(opcode == 28 ? 1 : 2)) {
+                    result->Instruction = instruction;
+                    if(opcode == 59)
+                        variables.push_back(instruction[2]);
+                }
+                break;
+        }
+    }
+    for(int i = 0; i < 3; ++i)
+        if(workgroupSizeIds[i])
+            workgroupSize[i] = spirvConstant(ids, workgroupSizeIds[i]);
+
+    // Resolve the variables to resources
+    std::string json = "{\n  \"entry_points\": [";
+    for(size_t i = 0; i < entryPoints.size(); ++i) {
+        json += i ? ", " : "";
+        json += "{ \"name\": ";
+        appendJsonString(json, entryPoints[i].Name);
+        json += ", \"stage\": ";
+        appendJsonString(json, spirvStageName(entryPoints[i].Model));
+        json += " }";
+    }
+    std::string descriptors, pushConstants, vertexInputs;
+    bool hasVertexStage = std::any_of(entryPoints.begin(), entryPoints.end(), [](const EntryPoint& entry) { return entry.Model == 0; });
+    for(uint32_t variableId : variables) {
+        const SpirvId& variable = ids[variableId];
+        if((variable.Instruction[0] >> 16) < 4)
+            continue;
+        uint32_t storageClass   = variable.Instruction[3];
+        uint32_t pointerId      = variable.Instruction[1];
+        if(pointerId >= ids.size() || !ids[pointerId].Instruction || (ids[pointerId].Instruction[0] & 0xFFFF) != 32)
+            continue;
+        uint32_t typeId = ids[pointerId].Instruction[3];
+        if(typeId >= ids.size() || !ids[typeId].Instruction)
+            continue;
+
+        // Unwrap (runtime) arrays of resources: count is 0 for unbounded arrays
+        uint32_t count = 1;
+        uint32_t typeOpcode = ids[typeId].Instruction[0] & 0xFFFF;
+        if((typeOpcode == 28 || typeOpcode == 29) && (storageClass == 0 || storageClass == 2 || storageClass == 12)) {
+            count  = typeOpcode == 28 ? spirvConstant(ids, ids[typeId].Instruction[3]) : 0;
+            typeId = ids[typeId].Instruction[2];
+            if(typeId >= ids.size())
+                continue;
+        }
+        std::string name = !variable.Name.empty() ? variable.Name : ids[typeId].Name;
+
+        if((storageClass == 0 || storageClass == 2 || storageClass == 12) && variable.Binding != ~0u) {
+            // UniformConstant, Uniform and StorageBuffer resources
+            descriptors += descriptors.empty() ? "\n    " : ",\n    ";
+            descriptors += "{ \"set\": " + std::to_string(variable.Set == ~0u ? 0 : variable.Set) + ", \"binding\": " + std::to_string(variable.Binding) + ", \"type\": ";
+            appendJsonString(descriptors, spirvDescriptorType(ids, typeId, storageClass));
+            descriptors += ", \"count\": " + std::to_string(count) + ", \"name\": ";
+            appendJsonString(descriptors, name);
+            descriptors += " }";
+        } else if(storageClass == 9) {
+            // PushConstant
+            pushConstants += pushConstants.empty() ? "\n    " : ",\n    ";
+            pushConstants += "{ \"name\": ";
+            appendJsonString(pushConstants, name);
+            pushConstants += ", \"size\": " + std::to_string(spirvTypeSize(ids, typeId)) + " }";
+        } else if(storageClass == 1 && hasVertexStage && !variable.BuiltIn && variable.Location != ~0u) {
+            // Input of the vertex stage
+            vertexInputs += vertexInputs.empty() ? "\n    " : ",\n    ";
+            vertexInputs += "{ \"location\": " + std::to_string(variable.Location) + ", \"name\": ";
+            appendJsonString(vertexInputs, name);
+            vertexInputs += ", \"type\": ";
+            appendJsonString(vertexInputs, spirvTypeName(ids, typeId));
+            vertexInputs += " }";
+        }
+    }
+    json += "],\n  \"descriptor_sets\": [" + descriptors + (descriptors.empty() ? "" : "\n  ") + "]";
+    json += ",\n  \"push_constants\": [" + pushConstants + (pushConstants.empty() ? "" : "\n  ") + "]";
+    json += ",\n  \"vertex_inputs\": [" + vertexInputs + (vertexInputs.empty() ? "" : "\n  ") + "]";
+    json += ",\n  \"workgroup_size\": [" + std::to_string(workgroupSize[0]) + ", " + std::to_string(workgroupSize[1]) + ", " + std::to_string(workgroupSize[2]) + "]\n}\n";
+
+    std::string metaDataPath = spirvPath + ".json";
+    {
+        std::ofstream metaData(metaDataPath + ".tmp", std::ios::binary | std::ios::trunc);
+        metaData << json;
+    }
+    std::error_code error;
+    fs::rename(metaDataPath + ".tmp", metaDataPath, error);
+}
+
+// Compile latency statistics; rolling windows of the most recent samples of each stage from a save to its SPIR-V on disk, 
+// overall and per shader (all in microseconds)
+// ----------------------------------------------------------------------------------------------------------------------
+enum LatencyStage {
+    StageDetection,   // file write -> change detected (requests triggered by a modification only)
+    StageQueueWait,   // (last coalesced) request -> compile started; includes the debounce window
+    StageCompileWall, // compiler run time (external and in-process compiles only)
+    StageCompileCPU,  // CPU time (user + system) used by the compiler
+    StageWrite,       // compiled -> output (and compile cache entry, metadata) written
+    StageTotal,       // file write -> output written
+    StageCount
+};
+static const char* sLatencyStageNames[StageCount] = { "detection", "queue_wait", "compile_wall", "compile_cpu", "write", "total" };
+
+struct LatencyWindow {
+    std::vector<int64_t> Samples;   // ring of the most recent samples
+    size_t               Next  = 0;
+    uint64_t             Count = 0; // number of samples ever added
+
+    void add(int64_t sample, size_t capacity) {
+        if(Samples.size() < capacity) {
+            Samples.push_back(sample);
+        } else {
+            Samples[Next] = sample;
+            Next = (Next + 1) % capacity;
+        }
+        ++Count;
+    }
+};
+struct ShaderStatistics {
+    LatencyWindow Stages[StageCount];
+    unsigned int  Restored = 0; // compiles served from the compile cache
+};
+static std::mutex                           sStatisticsMutex;
+static LatencyWindow                        sStageStatistics[StageCount];
+static std::map<fs::path, ShaderStatistics> sShaderStatistics;
+static const size_t                         sStageWindowSize  = 4096;
+static const size_t                         sShaderWindowSize = 64;
+
+// Record the stage timings of a finished compile; stages that weren't measured are -1
+void recordStatistics(const fs::path& shader, const int64_t (&timings)[StageCount], bool restored) {
+    std::lock_guard<std::mutex> lock(sStatisticsMutex);
+    ShaderStatistics& statistics = sShaderStatistics[shader];
+    statistics.Restored += restored ? 1 : 0;
+    for(int stage = 0; stage < StageCount; ++stage) {
+        if(timings[stage] < 0)
+            continue;
+        sStageStatistics[stage].add(timings[stage], sStageWindowSize);
+        statistics.Stages[stage].add(timings[stage], sShaderWindowSize);
+    }
+}
+
+// p50, p95, p99 (nearest rank) and the maximum of a window, -1 if it's empty (call with the statistics mutex held)
+std::array<int64_t, 4> summarizeWindow(const LatencyWindow& window) {
+    std::vector<int64_t> sorted = window.Samples;
+    if(sorted.empty())
+        return { -1, -1, -1, -1 };
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.5);
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    };
+    return { percentile(50), percentile(95), percentile(99), sorted.back() };
+}
+
+std::string formatMilliseconds(int64_t microseconds) {
+    if(microseconds < 0)
+        return "-";
+    char text[32];
+    snprintf(text, sizeof(text), "%.1fms", microseconds / 1000.0);
+    return text;
+}
+
+// Print the percentiles of every stage and the shaders that take the longest to reach disk (slowest p95 total, or compile time)
+void printStatistics() {
+    std::lock_guard<std::mutex> lock(sStatisticsMutex);
+    char line[256];
+    Log(LogLevel::Info) << "stage            samples      p50      p95      p99      max";
+    for(int stage = 0; stage < StageCount; ++stage) {
+        std::array<int64_t, 4> summary = summarizeWindow(sStageStatistics[stage]);
+        snprintf(line, sizeof(line), "%-14s %9llu %8s %8s %8s %8s", sLatencyStageNames[stage], static_cast<unsigned long long>(sStageStatistics[stage].Count),
+                 formatMilliseconds(summary[0]).c_str(), formatMilliseconds(summary[1]).c_str(), formatMilliseconds(summary[2]).c_str(), formatMilliseconds(summary[3]).c_str());
+        Log(LogLevel::Info) << line;
+    }
+
+    std::vector<std::pair<int64_t, fs::path>> slowest;
+    for(auto& shader : sShaderStatistics) {
+        int64_t total = summarizeWindow(shader.second.Stages[StageTotal])[1];
+        slowest.emplace_back(total >= 0 ? total : summarizeWindow(shader.second.Stages[StageCompileWall])[1], shader.first);
+    }
+    std::sort(slowest.begin(), slowest.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    if(slowest.size() > 10)
+        slowest.resize(10);
+    if(!slowest.empty())
+        Log(LogLevel::Info) << "slowest shaders (p50/p95/p99 compile, p95 total):";
+    for(auto& shader : slowest) {
+        const ShaderStatistics& statistics = sShaderStatistics[shader.second];
+        std::array<int64_t, 4> compile = summarizeWindow(statistics.Stages[StageCompileWall]);
+        snprintf(line, sizeof(line), "  %8s %8s %8s %8s  %s", formatMilliseconds(compile[0]).c_str(), formatMilliseconds(compile[1]).c_str(), 
+                 formatMilliseconds(compile[2]).c_str(), formatMilliseconds(summarizeWindow(statistics.Stages[StageTotal])[1]).c_str(), 
+                 shader.second.lexically_relative(sShaderSourceRoot).string().c_str());
+        Log(LogLevel::Info) << line;
+    }
+}
+
+// Write all statistics (overall and per shader) to a JSON file
+bool dumpStatistics(const std::string& path) {
+    auto appendStages = [](std::string& json, const LatencyWindow (&stages)[StageCount]) {
+        json += "{";
+        for(int stage = 0; stage < StageCount; ++stage) {
+            std::array<int64_t, 4> summary = summarizeWindow(stages[stage]);
+            json += std::string(stage > 0 ? "," : "") + "\"" + sLatencyStageNames[stage] + "\":{\"count\":" + std::to_string(stages[stage].Count) + 
+                    ",\"p50_us\":" + std::to_string(summary[0]) + ",\"p95_us\":" + std::to_string(summary[1]) + 
+                    ",\"p99_us\":" + std::to_string(summary[2]) + ",\"max_us\":" + std::to_string(summary[3]) + "}";
+        }
+        json += "}";
+    };
+    std::string json;
+    {
+        std::lock_guard<std::mutex> lock(sStatisticsMutex);
+        json = "{\n  \"stages\": ";
+        appendStages(json, sStageStatistics);
+        json += ",\n  \"shaders\": [";
+        bool first = true;
+        for(auto& shader : sShaderStatistics) {
+            json += first ? "\n    {\"path\":" : ",\n    {\"path\":";
+            appendJsonString(json, shader.first.string());
+            json += ",\"restored_from_cache\":" + std::to_string(shader.second.Restored) + ",\"stages\":";
+            appendStages(json, shader.second.Stages);
+            json += "}";
+            first = false;
+        }
+        json += "\n  ]\n}\n";
+    }
+    std::ofstream file(path, std::ios::trunc);
+    file << json;
+    return static_cast<bool>(file);
+}
+
+// Returns whether a newer version of the shader was queued since the compile started
+// ----------------------------------------------------------------------------------
+bool isOutdatedCompile(const CompileJob& job) {
+    std::lock_guard<std::mutex> lock(sCompileQueueMutex);
+    auto generation = sCompileGenerations.find(job.Path);
+    return generation == sCompileGenerations.end() || generation->second != job.Generation;
+}
+
+// Output path of a compiled shader; mirrors the shader's subdirectory (relative to the shader source folder) in the output folder
+// and names it after its stage's output template: {file} (the shader's file name), {name} (the file name without its stage 
+// suffix), {stage} and {spirv_ext}
+// -----------------------------------------------------------------------------------------------------------------------------
+fs::path getOutputPath(const fs::path& shader, uint8_t stage) {
+    // (shaders in the source folder itself are relative to "."; their output goes straight into the output folder)
+    fs::path relativeDirectory = shader.parent_path().lexically_relative(sShaderSourceRoot);
+    if(relativeDirectory.empty() || relativeDirectory == "." || *relativeDirectory.begin() == "..")
+        relativeDirectory = "";
+
+    std::string file = shader.filename().string();
+    const ShaderSuffix* suffix = findShaderSuffix(shader);
+    std::string name = suffix ? file.substr(0, file.size() - suffix->Suffix.size()) : shader.stem().string();
+    bool knownStage  = stage < sShaderStages.size();
+    std::string pattern = knownStage && !sShaderStages[stage].OutputName.empty() ? sShaderStages[stage].OutputName : config.OutputName;
+    std::string outputName;
+    for(size_t i = 0; i < pattern.size(); ++i) {
+        if(pattern.compare(i, 6, "{file}") == 0) {
+            outputName += file;
+            i += 5;
+        } else if(pattern.compare(i, 6, "{name}") == 0) {
+            outputName += name;
+            i += 5;
+        } else if(pattern.compare(i, 7, "{stage}") == 0) {
+            outputName += knownStage ? sShaderStages[stage].Name : "";
+            i += 6;
+        } else if(pattern.compare(i, 11, "{spirv_ext}") == 0) {
+            outputName += config.SPIRVExt;
+            i += 10;
+        } else {
+            outputName += pattern[i];
+        }
+    }
+    return fs::path(config.SPIRVOutputPath) / relativeDirectory / outputName;
+}
+
+// Name of an output file in the SPIR-V bundle and shared memory: its path relative to the output folder ('/' separated)
+// --------------------------------------------------------------------------------------------------------------------
+std::string spirvEntryName(const fs::path& outputPath) {
+    return outputPath.lexically_normal().lexically_relative(fs::path(config.SPIRVOutputPath).lexically_normal()).generic_string();
+}
+
+// Shared-memory SPIR-V delivery; compiled SPIR-V is also written into a named shared-memory segment (shm_open) that engines on
+// the same machine map to pick up new shaders without file I/O. The segment holds a header, a fixed-size index with an entry
+// per shader (open addressing on the hash of its spirvEntryName, like the bundle) and a ring of SPIR-V blobs. 
+// Readers treat the header's generation as a sequence lock: it's odd while an update is written, so read it, read the index 
+// entry, and retry if the generation changed (or was odd). A blob can be used in-place as long as the ring didn't wrap over it 
+// since: entry Offset + DataSize >= header WriteOffset (check after use too, as the ring only overwrites the oldest blobs)
+// ----------------------------------------------------------------------------------------------------------------------------
+#if defined __linux__ || defined __unix__
+struct SharedSPIRVHeader {
+    uint32_t              Magic;         // 'SASR'
+    uint32_t              Version;       // layout version (2)
+    uint64_t              Size;          // size of the whole segment
+    uint64_t              IndexOffset;   // offset of IndexCapacity SharedSPIRVEntry's
+    uint32_t              IndexCapacity;
+    uint32_t              EntryCount;
+    uint64_t              DataOffset;    // offset of the blob ring
+    uint64_t              DataSize;
+    std::atomic<uint64_t> Generation;    // incremented before and after every update (odd while writing)
+    std::atomic<uint64_t> WriteOffset;   // total bytes ever written to the ring; blob positions are modulo DataSize
+};
+struct SharedSPIRVEntry {
+    uint64_t PathHash;                   // 0 for an unused entry
+    uint64_t Generation;                 // generation of the update that wrote this blob
+    uint64_t Offset;                     // ring position of the blob (position in the ring is Offset % DataSize)
+    uint64_t Size;                       // size in bytes
+    uint64_t SPIRVHash;                  // FNV-1a of the blob
+    char     Path[216];                  // output file relative to the output folder (nul-terminated, / separated)
+};
+static_assert(sizeof(SharedSPIRVHeader) == 64, "shared-memory header layout changed");
+static_assert(sizeof(SharedSPIRVEntry) == 256, "shared-memory index entry layout changed");
+static SharedSPIRVHeader* sSharedSPIRV = nullptr;
+static std::mutex         sSharedSPIRVMutex;
+
+void initSharedSPIRV() {
+    if(config.SharedMemoryName.empty())
+        return;
+    // Without a configured size, keep the index at most half full with twice the shaders in the source tree on startup
+    uint32_t indexCapacity = config.SharedMemoryIndexSize;
+    if(indexCapacity == 0) {
+        uint32_t shaderCount = 0;
+        std::error_code error;
+        for(auto entry = fs::recursive_directory_iterator(sShaderSourceRoot, error); !error && entry != fs::recursive_directory_iterator(); entry.increment(error)) {
+            if(entry->is_directory(error)) {
+                if(!isWatchedDirectory(entry->path()))
+                    entry.disable_recursion_pending();
+            } else if(findShaderSuffix(entry->path())) {
+                ++shaderCount;
+            }
+        }
+        indexCapacity = std::max<uint32_t>(1024, shaderCount * 4);
+    }
+    uint64_t dataSize = static_cast<uint64_t>(std::max(1u, config.SharedMemoryMegabytes)) * 1024 * 1024;
+    uint64_t size     = sizeof(SharedSPIRVHeader) + indexCapacity * sizeof(SharedSPIRVEntry) + dataSize;
+    // Start with a fresh segment; an engine still mapping the previous one keeps it until it unmaps
+    shm_unlink(config.SharedMemoryName.c_str());
+    int fd = shm_open(config.SharedMemoryName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    void* memory = MAP_FAILED;
+    if(fd >= 0 && ftruncate(fd, size) == 0)
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(memory == MAP_FAILED) {
+        Log(LogLevel::Warning) << "Failed to create shared memory " << config.SharedMemoryName << ": " << strerror(errno) << ", shared-memory delivery disabled";
+        if(fd >= 0) {
+            close(fd);
+            shm_unlink(config.SharedMemoryName.c_str());
+        }
+        return;
+    }
+    close(fd);
+    // New segments are zero-filled, so only the header needs to be set
+    sSharedSPIRV = new(memory) SharedSPIRVHeader();
+    sSharedSPIRV->Magic         = 0x52534153;
+    sSharedSPIRV->Version       = 2;
+    sSharedSPIRV->Size          = size;
+    sSharedSPIRV->IndexOffset   = sizeof(SharedSPIRVHeader);
+    sSharedSPIRV->IndexCapacity = indexCapacity;
+    sSharedSPIRV->DataOffset    = sizeof(SharedSPIRVHeader) + indexCapacity * sizeof(SharedSPIRVEntry);
+    sSharedSPIRV->DataSize      = dataSize;
+}
+
+void releaseSharedSPIRV() {
+    if(!sSharedSPIRV)
+        return;
+    munmap(sSharedSPIRV, sSharedSPIRV->Size);
+    sSharedSPIRV = nullptr;
+    shm_unlink(config.SharedMemoryName.c_str());
+}
+
+bool sharedSPIRVEnabled() {
+    return sSharedSPIRV != nullptr;
+}
+
+// Write a shader's newly compiled SPIR-V to the ring and point the index entry of its output file at it
+void publishSharedSPIRV(const fs::path& outputPath, const std::string& spirv, uint64_t spirvHash) {
+    if(!sSharedSPIRV)
+        return;
+    std::string relativePath = spirvEntryName(outputPath);
+    if(relativePath.size() >= sizeof(SharedSPIRVEntry::Path) || spirv.size() > sSharedSPIRV->DataSize) {
+        Log(LogLevel::Warning) << "- " << outputPath.filename().string() << " can't be delivered through shared memory (path or SPIR-V too large)";
+        return;
+    }
+    char*             base    = reinterpret_cast<char*>(sSharedSPIRV);
+    SharedSPIRVEntry* entries = reinterpret_cast<SharedSPIRVEntry*>(base + sSharedSPIRV->IndexOffset);
+    char*             data    = base + sSharedSPIRV->DataOffset;
+    uint64_t          pathHash = std::max<uint64_t>(1, hashString(relativePath));
+
+    std::lock_guard<std::mutex> lock(sSharedSPIRVMutex);
+    // Find the shader's entry (or a free one)
+    SharedSPIRVEntry* entry = nullptr;
+    for(uint32_t i = 0; i < sSharedSPIRV->IndexCapacity; ++i) {
+        SharedSPIRVEntry& candidate = entries[(pathHash + i) % sSharedSPIRV->IndexCapacity];
+        if(candidate.PathHash == 0 || (candidate.PathHash == pathHash && relativePath == candidate.Path)) {
+            entry = &candidate;
+            break;
+        }
+    }
+    if(!entry) {
+        Log(LogLevel::Warning) << "- " << outputPath.filename().string() << " can't be delivered through shared memory (index full)";
+        return;
+    }
+    // Blobs are kept contiguous (and 4-byte aligned for SPIR-V words); skip the ring's tail if the blob doesn't fit before the end
+    uint64_t offset   = (sSharedSPIRV->WriteOffset.load(std::memory_order_relaxed) + 3) & ~uint64_t(3);
+    uint64_t position = offset % sSharedSPIRV->DataSize;
+    if(position + spirv.size() > sSharedSPIRV->DataSize)
+        offset += sSharedSPIRV->DataSize - position;
+
+    uint64_t generation = sSharedSPIRV->Generation.load(std::memory_order_relaxed) + 1;
+    sSharedSPIRV->Generation.store(generation, std::memory_order_relaxed);
+    sSharedSPIRV->WriteOffset.store(offset + spirv.size(), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(data + offset % sSharedSPIRV->DataSize, spirv.data(), spirv.size());
+    if(entry->PathHash == 0) {
+        entry->PathHash = pathHash;
+        strcpy(entry->Path, relativePath.c_str());
+        ++sSharedSPIRV->EntryCount;
+    }
+    entry->Generation = generation + 1;
+    entry->Offset     = offset;
+    entry->Size       = spirv.size();
+    entry->SPIRVHash  = spirvHash;
+    sSharedSPIRV->Generation.store(generation + 1, std::memory_order_release);
+}
+
+// Clear the index entry of a removed shader's output file; the entries after it in its probe sequence are shifted back so 
+// lookups still end at the first unused entry
+void unpublishSharedSPIRV(const fs::path& outputPath) {
+    if(!sSharedSPIRV)
+        return;
+    std::string       relativePath = spirvEntryName(outputPath);
+    char*             base         = reinterpret_cast<char*>(sSharedSPIRV);
+    SharedSPIRVEntry* entries      = reinterpret_cast<SharedSPIRVEntry*>(base + sSharedSPIRV->IndexOffset);
+    uint32_t          capacity     = sSharedSPIRV->IndexCapacity;
+    uint64_t          pathHash     = std::max<uint64_t>(1, hashString(relativePath));
+
+    std::lock_guard<std::mutex> lock(sSharedSPIRVMutex);
+    uint32_t index = capacity;
+    for(uint32_t i = 0; i < capacity; ++i) {
+        const SharedSPIRVEntry& candidate = entries[(pathHash + i) % capacity];
+        if(candidate.PathHash == 0)
+            break;
+        if(candidate.PathHash == pathHash && relativePath == candidate.Path) {
+            index = (pathHash + i) % capacity;
+            break;
+        }
+    }
+    if(index == capacity)
+        return;
+
+    uint64_t generation = sSharedSPIRV->Generation.load(std::memory_order_relaxed) + 1;
+    sSharedSPIRV->Generation.store(generation, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for(uint32_t step = 1, next = (index + 1) % capacity; step < capacity && entries[next].PathHash != 0; ++step, next = (next + 1) % capacity) {
+        // An entry can move into the hole unless its home slot lies cyclically after the hole (up to its current slot)
+        uint32_t home = entries[next].PathHash % capacity;
+        bool     stay = index <= next ? (index < home && home <= next) : (index < home || home <= next);
+        if(!stay) {
+            entries[index] = entries[next];
+            index          = next;
+        }
+    }
+    entries[index] = SharedSPIRVEntry();
+    --sSharedSPIRV->EntryCount;
+    sSharedSPIRV->Generation.store(generation + 1, std::memory_order_release);
+}
+#else
+bool sharedSPIRVEnabled() { return false; }
+void publishSharedSPIRV(const fs::path&, const std::string&, uint64_t) {}
+void unpublishSharedSPIRV(const fs::path&) {}
+#endif
+
+// SPIR-V bundle (bundle_file); all compiled shaders packed into a single file an engine can map and search instead of opening 
+// every .spv file on startup. Layout (little-endian): a BundleHeader, IndexCount BundleEntry's sorted by name hash (then by name),
+// the NUL-terminated names and the SPIR-V, each module starting at a 4-byte aligned offset. Entries are named after their output
+// file relative to the output folder ('/' separated, e.g. "lighting/deferred.frag.spv"); to find one, binary search the index 
+// for the FNV-1a hash of its name and compare the names of the entries with that hash. Compiles update the bundle in memory; it's
+// rewritten once a batch of compiles finished, to a temporary file that then replaces it so a mapped older version stays intact
+// -----------------------------------------------------------------------------------------------------------------------------
+struct BundleHeader {
+    uint32_t Magic;      // 'SPVB'
+    uint32_t Version;    // layout version (1)
+    uint32_t IndexCount;
+    uint32_t EntrySize;  // sizeof(BundleEntry)
+    uint64_t IndexOffset;
+    uint64_t Size;       // size of the whole file
+};
+struct BundleEntry {
+    uint64_t NameHash;   // FNV-1a of the name
+    uint64_t SPIRVHash;  // FNV-1a of the SPIR-V (changes whenever the shader does)
+    uint64_t Offset;     // of the SPIR-V
+    uint64_t Size;       // of the SPIR-V in bytes
+    uint32_t NameOffset; // of the name
+    uint32_t NameLength; // excluding the NUL terminator
+};
+static_assert(sizeof(BundleHeader) == 32 && sizeof(BundleEntry) == 40, "bundle layout changed");
+static const uint32_t                     sBundleMagic = 0x42565053; // 'SPVB'
+static std::mutex                         sBundleMutex;
+static std::map<std::string, std::string> sBundleShaders; // name -> SPIR-V
+static bool                               sBundleDirty = false;
+
+bool bundleEnabled() {
+    return !config.BundleFilePath.empty();
+}
+
+void updateBundle(const fs::path& outputPath, const std::string& spirv) {
+    if(!bundleEnabled())
+        return;
+    std::lock_guard<std::mutex> lock(sBundleMutex);
+    sBundleShaders[spirvEntryName(outputPath)] = spirv;
+    sBundleDirty = true;
+}
+
+void removeBundleEntry(const fs::path& outputPath) {
+    if(!bundleEnabled())
+        return;
+    std::lock_guard<std::mutex> lock(sBundleMutex);
+    sBundleDirty |= sBundleShaders.erase(spirvEntryName(outputPath)) > 0;
+}
+
+// Drop the entries that aren't the output of a watched shader (anymore); after the startup scan this removes the shaders that
+// were deleted while ShaderAssist wasn't running
+void pruneBundle() {
+    if(!bundleEnabled())
+        return;
+    std::set<std::string> outputs;
+    for(ShaderId id = 0; id < sShaders.Status.size(); ++id)
+        if(sShaders.Status[id] == ShaderWatched)
+            outputs.insert(spirvEntryName(getOutputPath(shaderPath(id), sShaders.Stages[id])));
+    std::lock_guard<std::mutex> lock(sBundleMutex);
+    for(auto shader = sBundleShaders.begin(); shader != sBundleShaders.end(); ) {
+        if(outputs.find(shader->first) == outputs.end()) {
+            shader       = sBundleShaders.erase(shader);
+            sBundleDirty = true;
+        } else {
+            ++shader;
+        }
+    }
+}
+
+// Read the bundle of a previous run; without a (valid) one, start from the SPIR-V already in the output folder
+// -----------------------------------------------------------------------------------------------------------
+void loadBundle() {
+    if(!bundleEnabled())
+        return;
+    std::lock_guard<std::mutex> lock(sBundleMutex);
+    std::string contents;
+    if(readFile(config.BundleFilePath, contents)) {
+        BundleHeader header = {};
+        if(contents.size() >= sizeof(header))
+            memcpy(&header, contents.data(), sizeof(header));
+        bool valid = header.Magic == sBundleMagic && header.Version == 1 && header.EntrySize == sizeof(BundleEntry) && header.Size == contents.size() &&
+                     header.IndexOffset + static_cast<uint64_t>(header.IndexCount) * sizeof(BundleEntry) <= contents.size();
+        for(uint32_t i = 0; valid && i < header.IndexCount; ++i) {
+            BundleEntry entry;
+            memcpy(&entry, contents.data() + header.IndexOffset + i * sizeof(BundleEntry), sizeof(entry));
+            valid = entry.NameOffset + static_cast<uint64_t>(entry.NameLength) <= contents.size() && entry.Offset + entry.Size <= contents.size();
+            if(valid)
+                sBundleShaders[contents.substr(entry.NameOffset, entry.NameLength)] = contents.substr(entry.Offset, entry.Size);
+        }
+        if(valid)
+            return;
+        Log(LogLevel::Warning) << "SPIR-V bundle " << config.BundleFilePath << " is invalid, rebuilding it from the output folder";
+        sBundleShaders.clear();
+    }
+    std::error_code error;
+    fs::path bundlePath = fs::path(config.BundleFilePath).lexically_normal();
+    for(auto entry = fs::recursive_directory_iterator(config.SPIRVOutputPath, error); !error && entry != fs::recursive_directory_iterator(); entry.increment(error)) {
+        const fs::path& p = entry->path();
+        std::string filename = p.filename().string();
+        if(filename[0] == '.') {
+            entry.disable_recursion_pending();
+            continue;
+        }
+        std::error_code typeError;
+        if(!entry->is_regular_file(typeError) || p.lexically_normal() == bundlePath || filename.size() < config.SPIRVExt.size() || 
+           filename.compare(filename.size() - config.SPIRVExt.size(), config.SPIRVExt.size(), config.SPIRVExt) != 0)
+            continue;
+        std::string spirv;
+        if(readFile(p, spirv))
+            sBundleShaders[spirvEntryName(p)] = std::move(spirv);
+    }
+    sBundleDirty = true;
+}
+
+// Write the bundle if any shader changed since it was last written
+// ----------------------------------------------------------------
+void saveBundle() {
+    if(!bundleEnabled())
+        return;
+    std::lock_guard<std::mutex> lock(sBundleMutex);
+    if(!sBundleDirty)
+        return;
+
+    // Index sorted by name hash; names follow the index, the 4-byte aligned SPIR-V follows the names
+    std::vector<std::pair<BundleEntry, const std::pair<const std::string, std::string>*>> index;
+    for(auto& shader : sBundleShaders) {
+        BundleEntry entry = {};
+        entry.NameHash   = hashBytes(shader.first.data(), shader.first.size());
+        entry.SPIRVHash  = hashBytes(shader.second.data(), shader.second.size());
+        entry.Size       = shader.second.size();
+        entry.NameLength = static_cast<uint32_t>(shader.first.size());
+        index.emplace_back(entry, &shader);
+    }
+    std::sort(index.begin(), index.end(), [](const auto& a, const auto& b) {
+        return a.first.NameHash != b.first.NameHash ? a.first.NameHash < b.first.NameHash : a.second->first < b.second->first;
+    });
+    uint64_t offset = sizeof(BundleHeader) + index.size() * sizeof(BundleEntry);
+    for(auto& entry : index) {
+        entry.first.NameOffset = static_cast<uint32_t>(offset);
+        offset += entry.first.NameLength + 1;
+    }
+    for(auto& entry : index) {
+        offset = (offset + 3) & ~uint64_t(3);
+        entry.first.Offset = offset;
+        offset += entry.first.Size;
+    }
+    BundleHeader header = { sBundleMagic, 1, static_cast<uint32_t>(index.size()), sizeof(BundleEntry), sizeof(BundleHeader), offset };
+
+    std::string contents(offset, '\0');
+    memcpy(&contents[0], &header, sizeof(header));
+    for(size_t i = 0; i < index.size(); ++i) {
+        const BundleEntry& entry = index[i].first;
+        memcpy(&contents[sizeof(header) + i * sizeof(BundleEntry)], &entry, sizeof(entry));
+        memcpy(&contents[entry.NameOffset], index[i].second->first.data(), entry.NameLength);
+        memcpy(&contents[entry.Offset], index[i].second->second.data(), entry.Size);
+    }
+    std::string temporaryPath = config.BundleFilePath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), contents.size());
+        if(!file.good()) {
+            Log(LogLevel::Error) << "Failed to write SPIR-V bundle " << config.BundleFilePath;
+            return;
+        }
+    }
+    std::error_code error;
+    fs::rename(temporaryPath, config.BundleFilePath, error);
+    sBundleDirty = false;
+}
+
+// Hot-reload notifications; engines (any number) connect to a local Unix socket and receive a JSON line for every compiled or 
+// failed shader the moment its output is in place, so they can reload exactly the changed pipelines instead of polling files
+// --------------------------------------------------------------------------------------------------------------------------
+#if defined __linux__ || defined __unix__
+static int              sNotifyListenFd = -1;
+static std::vector<int> sNotifySubscribers;
+static std::mutex       sNotifyMutex;
+
+void initNotifySocket() {
+    if(config.NotifySocketPath.empty())
+        return;
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(config.NotifySocketPath.size() >= sizeof(address.sun_path)) {
+        Log(LogLevel::Warning) << "Notification socket path " << config.NotifySocketPath << " is too long, notifications disabled";
+        return;
+    }
+    strcpy(address.sun_path, config.NotifySocketPath.c_str());
+    // Remove the socket of a previous run that didn't exit cleanly; never remove anything that isn't a socket, nor the socket of
+    // another instance that's still running (one that accepts connections)
+    struct stat status;
+    if(lstat(address.sun_path, &status) == 0) {
+        if(!S_ISSOCK(status.st_mode)) {
+            Log(LogLevel::Warning) << "Notification socket path " << config.NotifySocketPath << " exists and isn't a socket, notifications disabled";
+            return;
+        }
+        int probeFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live   = probeFd >= 0 && connect(probeFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if(probeFd >= 0)
+            close(probeFd);
+        if(live) {
+            Log(LogLevel::Warning) << "Notification socket " << config.NotifySocketPath << " is in use by another instance, notifications disabled";
+            return;
+        }
+        unlink(address.sun_path);
+    }
+    int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 16) != 0) {
+        Log(LogLevel::Warning) << "Failed to create notification socket " << config.NotifySocketPath << ": " << strerror(errno) << ", notifications disabled";
+        if(listenFd >= 0)
+            close(listenFd);
+        return;
+    }
+    sNotifyListenFd = listenFd;
+}
+
+void releaseNotifySocket() {
+    if(sNotifyListenFd < 0)
+        return;
+    std::lock_guard<std::mutex> lock(sNotifyMutex);
+    for(int subscriber : sNotifySubscribers)
+        close(subscriber);
+    sNotifySubscribers.clear();
+    close(sNotifyListenFd);
+    sNotifyListenFd = -1;
+    unlink(config.NotifySocketPath.c_str());
+}
+
+// Accept pending subscribers; called by the event loop when the socket is readable and before every notification
+void acceptSubscribers() {
+    if(sNotifyListenFd < 0)
+        return;
+    std::lock_guard<std::mutex> lock(sNotifyMutex);
+    int subscriber;
+    while((subscriber = accept4(sNotifyListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+        sNotifySubscribers.push_back(subscriber);
+}
+
+// Send a line to every subscriber; never blocks, a subscriber that disconnected or doesn't keep up reading is dropped
+void publishNotification(const std::string& line) {
+    if(sNotifyListenFd < 0)
+        return;
+    acceptSubscribers();
+    std::lock_guard<std::mutex> lock(sNotifyMutex);
+    for(auto subscriber = sNotifySubscribers.begin(); subscriber != sNotifySubscribers.end(); ) {
+        ssize_t sent = send(*subscriber, line.data(), line.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(sent == static_cast<ssize_t>(line.size())) {
+            ++subscriber;
+            continue;
+        }
+        if(sent >= 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+            Log(LogLevel::Warning) << "Dropped a notification subscriber that isn't reading its notifications";
+        close(*subscriber);
+        subscriber = sNotifySubscribers.erase(subscriber);
+    }
+}
+
+bool notificationsEnabled() {
+    return sNotifyListenFd >= 0;
+}
+#else
+void acceptSubscribers() {}
+void publishNotification(const std::string&) {}
+bool notificationsEnabled() { return false; }
+#endif
+
+// {"event":"compiled","shader":...,"output":...,"hash":<FNV-1a of the SPIR-V>,"took_ms":...,"cached":...}
+void notifyCompiled(const fs::path& shader, const std::string& outputPath, uint64_t hash, int64_t microseconds, bool cached) {
+    std::string line = "{\"event\":\"compiled\",\"shader\":";
+    appendJsonString(line, shader.string());
+    line += ",\"output\":";
+    appendJsonString(line, fs::absolute(outputPath).lexically_normal().string());
+    char fields[96];
+    snprintf(fields, sizeof(fields), ",\"hash\":\"%016llx\",\"took_ms\":%.1f,\"cached\":%s}\n", static_cast<unsigned long long>(hash), microseconds / 1000.0, cached ? "true" : "false");
+    publishNotification(line + fields);
+}
+
+// {"event":"failed","shader":...,"diagnostics":...}
+void notifyFailed(const fs::path& shader, const std::string& diagnostics) {
+    std::string line = "{\"event\":\"failed\",\"shader\":";
+    appendJsonString(line, shader.string());
+    line += ",\"diagnostics\":";
+    appendJsonString(line, diagnostics);
+    publishNotification(line + "}\n");
+}
+
+// Compile shader to SPIRV
+// -----------------------
+void compileShader(const CompileJob& job) {
+    // Latency of each stage for the statistics
+    auto started = std::chrono::steady_clock::now();
+    auto microsecondsSince = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+    int64_t timings[StageCount] = { job.Detection, std::chrono::duration_cast<std::chrono::microseconds>(started - job.Requested).count(), -1, -1, -1, -1 };
+    auto recordTimings = [&](std::chrono::steady_clock::time_point written, bool restored) {
+        timings[StageWrite] = microsecondsSince(written);
+        if(job.Detection >= 0)
+            timings[StageTotal] = job.Detection + microsecondsSince(job.Requested);
+        recordStatistics(job.Path, timings, restored);
+    };
+    traceAsyncSpan("queue", "queued " + job.Path.filename().string(), job.Requested, started);
+    std::string cacheResult = "disabled";
+    auto traceCompile = [&](const char* result) {
+        std::string args = "\"path\":";
+        appendJsonString(args, job.Path.string());
+        args += ",\"cache\":\"" + cacheResult + "\",\"result\":\"" + result + "\"";
+        traceSpan("compile", job.Path.filename().string(), started, std::chrono::steady_clock::now(), args);
+    };
+    // Optimize the compiled (or restored) output before it's moved into place; returns false if that failed, which fails the compile
+    auto optimize = [&](const std::string& temporaryOutputPath) {
+        if(config.SPIRVOptPath.empty())
+            return true;
+        auto optimizing = std::chrono::steady_clock::now();
+        std::string output;
+        bool cached;
+        bool optimized = optimizeSPIRV(temporaryOutputPath, job.Process.get(), output, cached);
+        traceSpan("optimize", cached ? "optimize (cached)" : "optimize", optimizing, std::chrono::steady_clock::now());
+        if(optimized)
+            return true;
+        std::error_code error;
+        fs::remove(temporaryOutputPath, error);
+        // The optimizer was killed as the application is quitting or the shader was modified again
+        if(sApplicationExit || isOutdatedCompile(job)) {
+            traceCompile("discarded");
+            return false;
+        }
+        while(!output.empty() && (output.back() == '\n' || output.back() == '\r'))
+            output.pop_back();
+        Log(LogLevel::Error) << "- Failed to optimize " << job.Path.filename().string() << ":\n" << output;
+        ++sFailedCount;
+        notifyFailed(job.Path, output);
+        traceCompile("failed");
+        return false;
+    };
+    // Put the new output in the bundle and shared memory and tell subscribed engines it's in place
+    auto notifyWritten = [&](const std::string& outputPath, bool cached) {
+        if(!notificationsEnabled() && !sharedSPIRVEnabled() && !bundleEnabled())
+            return;
+        std::string spirv;
+        readFile(outputPath, spirv);
+        uint64_t hash = hashBytes(spirv.data(), spirv.size());
+        updateBundle(outputPath, spirv);
+        publishSharedSPIRV(outputPath, spirv, hash);
+        notifyCompiled(job.Path, outputPath, hash, microsecondsSince(started), cached);
+    };
+
+    const fs::path& path   = job.Path;
+    std::string filename   = path.stem().string();
+    std::string ext        = path.extension().string();
+    std::string inputPath  = path.string();
+
+    // Includes may have changed with this modification, so update the dependency graph
+    std::string source;
+    std::vector<fs::path> includes;
+    bool sourceRead = readFile(path, source);
+    if(sourceRead)
+        collectIncludes(path, source, includes);
+    updateDependencies(path, includes);
+
+    // The stage (from the suffix or the source's #pragma shader_stage) picks the output name and the stage's compiler arguments
+    uint8_t stage              = resolveShaderStage(path, source);
+    const ShaderSuffix* suffix = findShaderSuffix(path);
+    bool isHLSL                = suffix && suffix->HLSL;
+    fs::path outputFile    = getOutputPath(path, stage);
+    std::string outputPath = outputFile.string();
+    if(outputFile.parent_path() != config.SPIRVOutputPath) {
+        std::error_code error;
+        fs::create_directories(outputFile.parent_path(), error);
+    }
+    // Compile to a temporary file that's only moved into place when the result is still up-to-date; this also means readers of the
+    // output never see a partially written file
+    std::string temporaryOutputPath = outputPath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+    std::vector<std::string> arguments;
+    if(config.UseInProcessCompiler) {
+        // (the stage's flags only apply to external compilers; the stage and language still go into the compile cache key)
+        arguments = { inputPath, stage < sShaderStages.size() ? sShaderStages[stage].Name : "", isHLSL ? "hlsl" : "glsl" };
+    } else {
+        if(config.UseGoogleSPIRV) {
+            arguments = { config.GLSLCPath };
+            arguments.insert(arguments.end(), sCompilerLeadingArguments.begin(), sCompilerLeadingArguments.end());
+            if(stage < sShaderStages.size())
+                arguments.push_back(std::string("-fshader-stage=") + sShaderStages[stage].Name);
+            if(isHLSL)
+                arguments.insert(arguments.end(), { "-x", "hlsl" });
+        } else {
+            arguments = { config.GLSLLangValidatorPath, "-V" };
+            if(stage < sShaderStages.size())
+                arguments.insert(arguments.end(), { "-S", sShaderStages[stage].Name });
+            if(isHLSL)
+                arguments.push_back("-D");
+        }
+        if(stage < sShaderStages.size())
+            arguments.insert(arguments.end(), sShaderStages[stage].Flags.begin(), sShaderStages[stage].Flags.end());
+        arguments.insert(arguments.end(), { inputPath, "-o", temporaryOutputPath });
+    }
+
+    // State of the sources as they're compiled now (for the compile cache and manifest)
+    FileState sourceState = getFileState(path, source);
+    std::vector<FileState> includeStates;
+    for(const fs::path& include : includes) {
+        std::string includeSource;
+        readFile(include, includeSource);
+        includeStates.push_back(getFileState(include, includeSource));
+    }
+    auto recordCompiled = [&] {
+        recordManifest(path, sourceState);
+        for(size_t i = 0; i < includes.size(); ++i)
+            recordManifest(includes[i], includeStates[i]);
+    };
+
+    // Restore previously compiled output of the exact same sources from the compile cache
+    std::string cachePath;
+    if(!config.CompileCachePath.empty() && sourceRead) {
+        // (a forced recompile skips the lookup but still stores its result)
+        std::vector<std::string> keyArguments = arguments;
+        if(!config.UseInProcessCompiler)
+            keyArguments.pop_back(); // output path doesn't affect the compiled result
+        cachePath = config.CompileCachePath + "/" + compileCacheKey(keyArguments, sourceState, includes, includeStates) + config.SPIRVExt;
+        cacheResult = "miss";
+
+        std::error_code error;
+        auto restoring = std::chrono::steady_clock::now();
+        if(!job.Forced && fs::copy_file(cachePath, temporaryOutputPath, fs::copy_options::overwrite_existing, error)) {
+            cacheResult = "hit";
+            if(!optimize(temporaryOutputPath))
+                return;
+            fs::rename(temporaryOutputPath, outputPath, error);
+            Log(LogLevel::Info) << "- " << filename + ext << " restored from compile cache";
+            ++sRestoredCount;
+            recordCompiled();
+            if(config.GenerateMetaData)
+                generateMetaData(outputPath);
+            recordTimings(restoring, true);
+            notifyWritten(outputPath, true);
+            traceSpan("cache", "restore", restoring, std::chrono::steady_clock::now());
+            traceCompile("restored");
+            return;
+        }
+    }
+
+    std::string output;
+    int exitCode;
+    auto compiling = std::chrono::steady_clock::now();
+#ifdef SHADERASSIST_SHADERC
+    if(config.UseInProcessCompiler) {
+        if(!sourceRead) {
+            exitCode = 1;
+            output   = "unable to open " + inputPath;
+        } else {
+#if defined __linux__ || defined __unix__
+            timespec cpuStart, cpuEnd;
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
+            exitCode = compileShaderInProcess(inputPath, stage, isHLSL, source, temporaryOutputPath, output);
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+            timings[StageCompileCPU] = (static_cast<int64_t>(cpuEnd.tv_sec) - cpuStart.tv_sec) * 1000000 + (cpuEnd.tv_nsec - cpuStart.tv_nsec) / 1000;
+#else
+            exitCode = compileShaderInProcess(inputPath, stage, isHLSL, source, temporaryOutputPath, output);
+#endif
+        }
+    } else
+#endif
+    exitCode = runProcess(arguments, output, job.Process.get(), &timings[StageCompileCPU]);
+    timings[StageCompileWall] = microsecondsSince(compiling);
+    auto compiled = std::chrono::steady_clock::now();
+    traceSpan("compiler", "compiler", compiling, compiled, "\"exit_code\":" + std::to_string(exitCode));
+
+    // Application is quitting (the compiler may have been killed for it); drop this result
+    std::error_code error;
+    if(sApplicationExit) {
+        fs::remove(temporaryOutputPath, error);
+        return;
+    }
+    // The shader was modified again while compiling (the compiler may have been killed for it); drop this result
+    if(isOutdatedCompile(job)) {
+        Log(LogLevel::Info) << "- Discarded outdated compile of " << filename + ext << " (modified again or removed while compiling)";
+        fs::remove(temporaryOutputPath, error);
+        traceCompile("discarded");
+        return;
+    }
+
+    while(!output.empty() && (output.back() == '\n' || output.back() == '\r'))
+        output.pop_back();
+    if(exitCode != 0) {
+        Log(LogLevel::Error) << "- Failed to compile " << filename + ext << ":\n" << output;
+        fs::remove(temporaryOutputPath, error);
+        ++sFailedCount;
+        notifyFailed(job.Path, output);
+        traceCompile("failed");
+        return;
+    } else if((config.UseGoogleSPIRV || config.UseInProcessCompiler) && !output.empty()) {
+        // Only show output of successful compiles for glslc/shaderc (warnings); glslangValidator always echoes the compiled file's name
+        Log(LogLevel::Warning) << output;
+    }
+
+    // Store the result in the compile cache (before optimizing, so restored output goes through the optimizer's own cache)
+    if(!cachePath.empty())
+        storeFileAtomically(temporaryOutputPath, cachePath);
+    if(!optimize(temporaryOutputPath))
+        return;
+    ++sCompiledCount;
+    recordCompiled();
+    fs::rename(temporaryOutputPath, outputPath, error);
+    if(config.GenerateMetaData)
+        generateMetaData(outputPath);
+    recordTimings(compiled, false);
+    notifyWritten(outputPath, false);
+    traceSpan("write", "write", compiled, std::chrono::steady_clock::now());
+    traceCompile("compiled");
+}
+
+// Hand a shader over to the compile workers; returns immediately so detection keeps running while compiles are in flight
+// ----------------------------------------------------------------------------------------------------------------------
+// (writeTime is the write time of the modification that triggered the request for latency statistics, 0 if not triggered by one)
+void queueCompile(const fs::path& path, int64_t writeTime = 0, bool forced = false) {
+    {
+        std::lock_guard<std::mutex> lock(sCompileQueueMutex);
+        ++sCompileGenerations[path];
+
+        // Already queued; coalesce with the pending request and restart its debounce window
+        auto now = std::chrono::steady_clock::now();
+        PendingCompile request = { now + std::chrono::milliseconds(config.DebounceMilliseconds), now, writeTime != 0 ? microsecondsSinceWrite(writeTime) : -1, forced };
+        auto pending = sCompileQueueDue.find(path);
+        if(pending != sCompileQueueDue.end()) {
+            request.Forced |= pending->second.Forced;
+            pending->second = request;
+        } else {
+            sCompileQueueDue[path] = request;
+            sCompileQueue.push_back(path);
+        }
+
+        // A compile of an older version is running; stop it as its result is outdated
+        auto inFlight = sCompilesInFlight.find(path);
+        if(inFlight != sCompilesInFlight.end() && inFlight->second.Process)
+            cancelProcess(*inFlight->second.Process);
+    }
+    sCompileQueueCondition.notify_one();
+}
+
+// Recompile all watched shaders that include a modified file
+// ----------------------------------------------------------
+void queueDependents(const fs::path& include, int64_t writeTime = 0) {
+    std::vector<fs::path> dependents = getDependents(include);
+    if(dependents.empty())
+        return;
+    Log(LogLevel::Info) << "- Include " << include.filename().string() << " is modified, recompiling " << dependents.size() << " dependent shader(s)...";
+    for(const fs::path& shader : dependents)
+        if(findShader(shader) != sNoShader)
+            queueCompile(shader, writeTime);
+}
+
+// Terminate all running compiler processes (on quit, so exiting doesn't wait for compiles to finish)
+// -------------------------------------------------------------------------------------------------
+void cancelCompiles() {
+    std::lock_guard<std::mutex> lock(sCompileQueueMutex);
+    for(auto& compile : sCompilesInFlight)
+        if(compile.second.Process)
+            cancelProcess(*compile.second.Process);
+}
+
+// Exit the compile workers; shaders still waiting in the compile queue are dropped and running compiles are cancelled (their 
+// temporary output is removed by the workers)
+// --------------------------------------------------------------------------------------------------------------------------
+void stopCompileWorkers(std::vector<std::thread>& workers) {
+    sApplicationExit = true;
+    cancelCompiles();
+    {
+        std::lock_guard<std::mutex> lock(sCompileQueueMutex);
+    }
+    sCompileQueueCondition.notify_all();
+    for(auto& thread : workers)
+        thread.join();
+}
+
+// Wake up the event loop if it's blocked waiting for events
+// --------------------------------------------------------
+void wakeEventLoop() {
+#ifdef __linux__
+    if(sWakeEventFd >= 0) {
+        uint64_t value = 1;
+        (void)write(sWakeEventFd, &value, sizeof(value));
+    }
+#endif
+}
+
+// Quit cleanly on SIGINT/SIGTERM, the only way to stop ShaderAssist without user input (e.g. when running as a service); only 
+// sets the exit flag and wakes the event loop, which are both safe to do from a signal handler
+// -----------------------------------------------------------------------------------------------------------------------------
+void handleQuitSignal(int) {
+    sApplicationExit = true;
+    wakeEventLoop();
+}
+
+void installQuitSignalHandlers() {
+#if defined __linux__ || defined __unix__
+    // Without SA_RESTART, so a blocking read of user input is interrupted as well
+    struct sigaction action = {};
+    action.sa_handler = handleQuitSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+#else
+    std::signal(SIGINT, handleQuitSignal);
+    std::signal(SIGTERM, handleQuitSignal);
+#endif
+}
+
+// Compile worker; keeps taking shaders from the compile queue until the application exits
+// ---------------------------------------------------------------------------------------
+void compileWorker(int lane) {
+    sTraceLane = lane;
+    while(true) {
+        CompileJob job;
+        {
+            // Take the first shader whose debounce window passed and that isn't being compiled by another worker right now
+            std::unique_lock<std::mutex> lock(sCompileQueueMutex);
+            while(true) {
+                if(sApplicationExit)
+                    return;
+                auto now      = std::chrono::steady_clock::now();
+                auto nextDue  = std::chrono::steady_clock::time_point::max();
+                auto ready    = sCompileQueue.end();
+                for(auto pending = sCompileQueue.begin(); pending != sCompileQueue.end(); ++pending) {
+                    if(sCompilesInFlight.find(*pending) != sCompilesInFlight.end())
+                        continue;
+                    auto due = sCompileQueueDue[*pending].Due;
+                    if(due <= now) {
+                        ready = pending;
+                        break;
+                    }
+                    nextDue = std::min(nextDue, due);
+                }
+                if(ready != sCompileQueue.end()) {
+                    job.Path = std::move(*ready);
+                    sCompileQueue.erase(ready);
+                    job.Requested = sCompileQueueDue[job.Path].Requested;
+                    job.Detection = sCompileQueueDue[job.Path].Detection;
+                    job.Forced    = sCompileQueueDue[job.Path].Forced;
+                    sCompileQueueDue.erase(job.Path);
+                    break;
+                }
+                if(nextDue == std::chrono::steady_clock::time_point::max()) {
+                    sCompileQueueCondition.wait(lock);
+                } else {
+                    sCompileQueueCondition.wait_until(lock, nextDue);
+                }
+            }
+            job.Generation = sCompileGenerations[job.Path];
+            // The in-process compiler runs no process, but the optimizer run after it does
+            if(!config.UseInProcessCompiler || !config.SPIRVOptPath.empty())
+                job.Process = std::make_shared<ProcessHandle>();
+            sCompilesInFlight[job.Path] = job;
+        }
+        compileShader(job);
+
+        // Persist the manifest whenever the last compile of a batch finishes; the event loop takes care of this when it's running
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(sCompileQueueMutex);
+            sCompilesInFlight.erase(job.Path);
+            idle = sCompilesInFlight.empty() && sCompileQueue.empty();
+        }
+        // Another worker may be waiting for this shader to finish before compiling its newer version
+        sCompileQueueCondition.notify_all();
+        sCompileFinishedCondition.notify_all();
+        if(idle && sEventLoopRunning) {
+            wakeEventLoop();
+        } else if(idle) {
+            saveManifest();
+            saveBundle();
+        }
+    }
+}
+
+// Start watching a newly found shader; records its current state and includes (source receives the shader's contents)
+// --------------------------------------------------------------------------------------------------------------------
+ShaderId addShaderEntry(const fs::path& p, std::string& source) {
+    std::vector<fs::path> includes;
+    FileStat fileStat = FileStat();
+    statFile(p, fileStat);
+    if(readFile(p, source))
+        collectIncludes(p, source, includes);
+    uint8_t stage = resolveShaderStage(p, source);
+    if(stage == sUnknownStage)
+        Log(LogLevel::Warning) << "- " << p.filename().string() << " has no (known) #pragma shader_stage(<stage>), leaving its stage to the compiler";
+
+    ShaderId id = internShader(p, stage);
+    if(sShaders.Status[id] != ShaderWatched) {
+        sShaders.Status[id] = ShaderWatched;
+        ++sShaders.Watched;
+    }
+    sShaders.Stats[id]  = fileStat;
+    sShaders.Hashes[id] = hashBytes(source.data(), source.size());
+    sShaders.Stages[id] = stage;
+    updateDependencies(p, includes);
+    return id;
+}
+
+// Check a single shader file and queue a compile when it's newly added or modified since the last check
+// -----------------------------------------------------------------------------------------------------
+void checkShader(const fs::path& p) {
+    ShaderId id = findShader(p);
+    if(id != sNoShader) {
+        // Compare write time, size and inode (confirmed by content hash); if it's different; re-compile
+        bool modified = checkModified(p, sShaders.Stats[id], sShaders.Hashes[id]);
+        if(modified || sRecompile) {
+            // File has been adjusted, re-compile
+            Log(LogLevel::Info) << "- File " << p.filename().string() << " is modified, recompiling...";
+            queueCompile(p, modified ? sShaders.Stats[id].WriteTime : 0, sRecompile);
+        }
+    } else {
+        // Newly added shader; add to entry, find its includes and compile
+        std::string source;
+        id = addShaderEntry(p, source);
 
-// Global state
-// ------------
-static std::atomic<bool> sApplicationExit = false;
-static std::atomic<bool> sRecompile       = false;
-static bool              sFirstIteration  = true;
+        if(sFirstIteration && sBuildMode) {
+            // Batch build: compile everything that's out-of-date with respect to the manifest (or that's missing its output)
+            std::error_code error;
+            if(!matchesManifest(p) || !fs::exists(getOutputPath(p, sShaders.Stages[id]), error)) {
+                Log(LogLevel::Info) << "- Compiling " << p.lexically_relative(sShaderSourceRoot).string();
+                queueCompile(p);
+            }
+        } else if(sFirstIteration && sManifestLoaded && !sRecompile) {
+            // Compare against the manifest of the previous run; only compile what changed since
+            if(!matchesManifest(p)) {
+                Log(LogLevel::Info) << "- File " << p.filename().string() << " was modified while ShaderAssist wasn't running, compiling...";
+                queueCompile(p);
+            }
+        } else if(!sFirstIteration || config.CompileOnStartup) {
+            Log(LogLevel::Info) << "- Newly recognized file: " << p.filename().string() << ", compiling...";
+            queueCompile(p, sFirstIteration ? 0 : sShaders.Stats[id].WriteTime);
+        } else {
+            // Don't compile the first iteration (unless specified in .ini) as every shader checked will satisfy time delta requirement
+            // first run; the existing output is assumed to be up-to-date so record it as the manifest's baseline
+            recordManifest(p, getFileState(p, source));
+        }
+    }
+}
 
-// Data structure for each shader file that's being watched
-// --------------------------------------------------------
-struct ShaderEntry {
-    fs::file_time_type  LastWriteTime;
+// Stop watching a shader that was removed (or whose directory was removed)
+// ------------------------------------------------------------------------
+void removeShaderEntry(const fs::path& p) {
+    ShaderId id = findShader(p);
+    if(id != sNoShader) {
+        sShaders.Status[id] = ShaderRemoved;
+        --sShaders.Watched;
+        fs::path outputPath = getOutputPath(p, sShaders.Stages[id]);
+        removeBundleEntry(outputPath);
+        unpublishSharedSPIRV(outputPath);
+    }
+    updateDependencies(p, {});
+    forgetManifest(p);
+
+    // Drop its pending compile and compile count; a compile still running is outdated now, so its result is discarded
+    std::lock_guard<std::mutex> lock(sCompileQueueMutex);
+    if(sCompileQueueDue.erase(p) != 0)
+        sCompileQueue.erase(std::find(sCompileQueue.begin(), sCompileQueue.end(), p));
+    sCompileGenerations.erase(p);
+    auto inFlight = sCompilesInFlight.find(p);
+    if(inFlight != sCompilesInFlight.end() && inFlight->second.Process)
+        cancelProcess(*inFlight->second.Process);
+}
+
+// Directory listing cache; a directory is only re-enumerated when its own write time changed (an entry was added, removed or
+// renamed), so an idle scan only stats each directory and the shaders it contains
+// ----------------------------------------------------------------------------------------------------------------------------
+struct DirectoryEntry {
+    FileStat              Stat;
+    std::vector<fs::path> Shaders;
+    std::vector<fs::path> Subdirectories;
 };
-// Store file data for all shader that's being watched
-static std::map<fs::path, ShaderEntry> sShaderEntries;
+static std::map<fs::path, DirectoryEntry> sDirectoryEntries;
 
-// Compile shader to SPIRV
-// -----------------------
-void compileShader(std::string filename, std::string ext) {
-    std::string command = "";
-    if(config.UseGoogleSPIRV) {
-        command = config.GLSLCPath + " " + filename + ext + " -o " + config.SPIRVOutputPath + "/" + filename + ext + config.SPIRVExt;
-    } else {
-        command = config.GLSLLangValidatorPath + " - V " + filename + ext + " -o " + config.SPIRVOutputPath + "/" + filename + ext + config.SPIRVExt;
+void forgetDirectory(const fs::path& directory) {
+    auto entry = sDirectoryEntries.find(directory);
+    if(entry == sDirectoryEntries.end())
+        return;
+    for(const fs::path& shader : entry->second.Shaders)
+        removeShaderEntry(shader);
+    std::vector<fs::path> subdirectories = std::move(entry->second.Subdirectories);
+    sDirectoryEntries.erase(entry);
+    for(const fs::path& subdirectory : subdirectories)
+        forgetDirectory(subdirectory);
+}
+
+// Check all shaders in a directory and its subdirectories; (re-)enumerates the directory if its listing changed
+void scanDirectory(const fs::path& directory) {
+    FileStat directoryStat;
+    if(!statFile(directory, directoryStat)) {
+        forgetDirectory(directory);
+        return;
     }
-#ifdef _WIN32
-    system((command + " > nul").c_str());
-#elif defined __linux__ || defined __unix__ 
-    system((command + " > /dev/null").c_str());
-#else 
-    system(command.c_str());
+    DirectoryEntry& entry = sDirectoryEntries[directory];
+    if(entry.Stat != directoryStat) {
+        // Take the directory's state before enumerating; anything changing during enumeration then triggers another enumeration next scan
+        entry.Stat = directoryStat;
+#ifdef __linux__
+        {
+            std::lock_guard<std::mutex> lock(sDependencyMutex);
+            addInotifyWatch(directory);
+        }
 #endif
+        // Get a reference to each shader file and subdirectory in this directory
+        std::vector<fs::path> shaders;
+        std::vector<fs::path> subdirectories;
+        std::error_code error;
+        for(auto& p : fs::directory_iterator(directory, error)) {
+            // Symlinked directories aren't followed; a link back up the tree would otherwise recurse until ELOOP, watching (and 
+            // compiling) the same shaders under ever longer paths
+            std::error_code typeError;
+            if(p.is_directory(typeError) && !p.is_symlink(typeError)) {
+                if(isWatchedDirectory(p.path()))
+                    subdirectories.push_back(p.path());
+            } else if(p.is_regular_file(typeError) && isShaderFile(p.path())) {
+                shaders.push_back(p.path());
+            }
+        }
+        for(const fs::path& shader : entry.Shaders)
+            if(std::find(shaders.begin(), shaders.end(), shader) == shaders.end())
+                removeShaderEntry(shader);
+        for(const fs::path& subdirectory : entry.Subdirectories)
+            if(std::find(subdirectories.begin(), subdirectories.end(), subdirectory) == subdirectories.end())
+                forgetDirectory(subdirectory);
+        entry.Shaders        = std::move(shaders);
+        entry.Subdirectories = std::move(subdirectories);
+    }
+
+    for(const fs::path& shader : entry.Shaders)
+        checkShader(shader);
+    // Scanning a subdirectory only adds or removes the entries of its own subtree, so this entry (and its list) stays valid
+    for(size_t i = 0; i < entry.Subdirectories.size(); ++i)
+        scanDirectory(entry.Subdirectories[i]);
 }
 
-// Continously checks all shader files in .ini-specified directory for modifications and automatically compile to SPIRV when modified
+// Checks all shader files in the directory tree once and compiles the ones that were modified (or newly added) since the last check
 // ----------------------------------------------------------------------------------------------------------------------------------
-void watchShaders(fs::path path) {
-    // Get a reference to each shader file in this directory (repeat this every time in case new files get added)
-    while(!sApplicationExit) {
-        for(auto& p : fs::directory_iterator(path)) {
-            if(fs::is_regular_file(p)) {
-                std::string filename    = fs::path(p).stem().string();
-                std::string extension   = fs::path(p).extension().string();
-
-                std::array<std::string, 4> validFileExts = { config.VSExt, config.FSExt, config.GSExt, config.CSExt };
-                if(std::find(validFileExts.begin(), validFileExts.end(), extension) != validFileExts.end()) {
-                    if(sShaderEntries.find(p) != sShaderEntries.end()) {
-                        // Compare timestamps, if it's different; re-compile
-                        fs::file_time_type currFileTimeType = fs::last_write_time(p);
-                        std::time_t lastWriteTime    = fs::file_time_type::clock::to_time_t(sShaderEntries[p].LastWriteTime);;
-                        std::time_t currentWriteTime = fs::file_time_type::clock::to_time_t(currFileTimeType);
-                        if(currentWriteTime - lastWriteTime > 1 || sRecompile) { // In seconds
-                            // File has been adjusted, re-compile
-                            std::cout << "- File " << filename + extension << " is modified, recompiling..." << std::endl;
-                            compileShader(filename, extension);
-                            // And update time stamp
-                            sShaderEntries[p].LastWriteTime = currFileTimeType;
-                        }
-                    } else {
-                        // Newly added shader; add to entry and compile
-                        sShaderEntries[p] = { fs::last_write_time(p) };
-
-                        // Don't compile the first iteration (unless specified in .ini) as every shader checked will satisfy time delta requirement first run
-                        if(!sFirstIteration || config.CompileOnStartup) {
-                            std::cout << "- Newly recognized file: " << filename + extension << ", compiling..." << std::endl;
-                            compileShader(filename, extension);
-                        }
-                    }
+void scanShaders(const fs::path& path) {
+    auto started = std::chrono::steady_clock::now();
+    scanDirectory(path);
+
+    // Check the includes of all shaders (these can live outside of the shader directory and have any extension)
+    std::vector<std::pair<fs::path, int64_t>> modifiedIncludes;
+    {
+        std::lock_guard<std::mutex> lock(sDependencyMutex);
+        for(auto& include : sIncludeEntries)
+            if(checkModified(include.first, include.second))
+                modifiedIncludes.emplace_back(include.first, include.second.Stat.WriteTime);
+    }
+    if(!sRecompile)
+        for(auto& include : modifiedIncludes)
+            queueDependents(include.first, include.second);
+
+    // On startup, also recompile the dependents of includes modified while ShaderAssist wasn't running
+    if(sFirstIteration && !sRecompile) {
+        std::vector<fs::path> includes;
+        {
+            std::lock_guard<std::mutex> lock(sDependencyMutex);
+            for(auto& include : sIncludeEntries)
+                includes.push_back(include.first);
+        }
+        for(const fs::path& include : includes) {
+            if(sManifestLoaded) {
+                bool recorded;
+                {
+                    std::lock_guard<std::mutex> lock(sManifestMutex);
+                    recorded = sManifest.find(include) != sManifest.end();
                 }
+                if(recorded && !matchesManifest(include))
+                    queueDependents(include);
+            } else if(!config.CompileOnStartup && !sBuildMode) {
+                std::string source;
+                readFile(include, source);
+                recordManifest(include, getFileState(include, source));
             }
         }
-        sFirstIteration = false;
-        sRecompile      = false;
+        saveManifest();
+    }
+    if(sFirstIteration)
+        pruneBundle();
+    traceSpan("scan", sFirstIteration ? "startup scan" : sRecompile ? "recompile scan" : "scan", started, std::chrono::steady_clock::now());
+    sFirstIteration = false;
+    sRecompile      = false;
+}
+
+// Continously checks all shader files in .ini-specified directory for modifications and automatically compile to SPIRV when modified
+// ----------------------------------------------------------------------------------------------------------------------------------
+void watchShadersPoll(fs::path path) {
+    while(!sApplicationExit) {
+        scanShaders(path);
         // Wait for 1 second and check again (don't stress the CPU)
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     }
 }
 
+// Handle a single line of user input; returns false when the user asked to quit
+// ----------------------------------------------------------------------------
+bool processCommand(const std::string& line) {
+    if(line == "-h" || line == "-help" || line == "help") {
+        Log(LogLevel::Info) << "commands:";
+        Log(LogLevel::Info) << "-h|-help|help:        list of commands";
+        Log(LogLevel::Info) << "-q|-quit|quit|exit:   quit ShaderAssist";
+        Log(LogLevel::Info) << "-r|-recompile:        recompile all shaders";
+        Log(LogLevel::Info) << "-stats [file]:        compile latency percentiles (or write all statistics to a JSON file)";
+    }
+    if(line == "-q" || line == "-quit" || line == "quit" || line == "exit")
+        return false;
+    if(line == "-r" || line == "-recompile") {
+        Log(LogLevel::Info) << "forcing recompile";
+        sRecompile = true;
+        wakeEventLoop();
+    }
+    if(line == "-stats") {
+        printStatistics();
+    } else if(line.compare(0, 7, "-stats ") == 0) {
+        std::string path = line.substr(7);
+        if(dumpStatistics(path))
+            Log(LogLevel::Info) << "statistics written to " << path;
+        else
+            Log(LogLevel::Error) << "Failed to write statistics to " << path;
+    }
+    return true;
+}
+
+#ifdef __linux__
+// Start watching the shader source folder with inotify; subdirectories get watched as they're enumerated and the directories
+// of includes as the dependency graph is built. Returns the inotify descriptor, or -1 if inotify is unavailable
+// --------------------------------------------------------------------------------------------------------------------------
+int initInotify(const fs::path& path) {
+    int inotifyFd   = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int shaderWatch = inotifyFd >= 0 ? inotify_add_watch(inotifyFd, path.c_str(), sInotifyWatchMask) : -1;
+    if(shaderWatch < 0) {
+        if(inotifyFd >= 0)
+            close(inotifyFd);
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(sDependencyMutex);
+    sInotifyFd = inotifyFd;
+    sInotifyWatches[shaderWatch] = path;
+    sInotifyWatchedDirectories.insert(path);
+    for(auto& include : sIncludeDependents)
+        addInotifyWatch(include.first.parent_path());
+    return inotifyFd;
+}
+
+void releaseInotify(int inotifyFd) {
+    {
+        std::lock_guard<std::mutex> lock(sDependencyMutex);
+        sInotifyFd = -1;
+        sInotifyWatches.clear();
+        sInotifyWatchedDirectories.clear();
+    }
+    close(inotifyFd);
+}
+
+// Handle pending inotify events; only recompiles the files the kernel reports as written, so no directory walks or stat calls 
+// are done while idle
+// ---------------------------------------------------------------------------------------------------------------------------
+void handleInotifyEvents(const fs::path& path, int inotifyFd) {
+    auto started = std::chrono::steady_clock::now();
+    // Directories whose listing changed (added/removed/renamed entries) and need to be re-enumerated
+    std::set<fs::path> rescanDirectories;
+    bool rescan = false;
+    alignas(inotify_event) char buffer[16 * 1024];
+    ssize_t length;
+    while((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for(char* ptr = buffer; ptr < buffer + length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            // Kernel event queue overflowed; we no longer know what changed so do a full timestamp scan
+            if(event->mask & IN_Q_OVERFLOW) {
+                rescan = true;
+                continue;
+            }
+            fs::path directory;
+            {
+                std::lock_guard<std::mutex> lock(sDependencyMutex);
+                auto watch = sInotifyWatches.find(event->wd);
+                if(watch == sInotifyWatches.end())
+                    continue;
+                directory = watch->second;
+                // Watched directory itself was removed; the kernel dropped the watch so allow it to be watched again once recreated
+                if(event->mask & IN_IGNORED) {
+                    sInotifyWatchedDirectories.erase(directory);
+                    sInotifyWatches.erase(watch);
+                    continue;
+                }
+            }
+            if(event->len == 0)
+                continue;
+            bool isSourceDirectory = sDirectoryEntries.find(directory) != sDirectoryEntries.end();
+
+            // Removed include; recompile the shaders depending on it so they report the missing file
+            if(!(event->mask & IN_ISDIR) && (event->mask & (IN_DELETE | IN_MOVED_FROM))) {
+                fs::path p = directory / event->name;
+                bool isInclude = false;
+                {
+                    std::lock_guard<std::mutex> lock(sDependencyMutex);
+                    auto include = sIncludeEntries.find(p);
+                    if(include != sIncludeEntries.end())
+                        isInclude = checkModified(p, include->second);
+                }
+                if(isInclude)
+                    queueDependents(p);
+            }
+
+            // Subdirectory added/removed or a file removed; re-enumerate the directory (files that are created get handled once written)
+            if((event->mask & IN_ISDIR) || (event->mask & (IN_DELETE | IN_MOVED_FROM))) {
+                if(isSourceDirectory)
+                    rescanDirectories.insert(directory);
+                continue;
+            }
+            if(!(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)))
+                continue;
+
+            fs::path p = directory / event->name;
+            if(!fs::is_regular_file(p))
+                continue;
+
+            // Modified include; recompile only the shaders depending on it
+            bool isInclude = false;
+            int64_t writeTime = 0;
+            {
+                std::lock_guard<std::mutex> lock(sDependencyMutex);
+                auto include = sIncludeEntries.find(p);
+                if(include != sIncludeEntries.end()) {
+                    isInclude = checkModified(p, include->second);
+                    writeTime = include->second.Stat.WriteTime;
+                }
+            }
+            if(isInclude)
+                queueDependents(p, writeTime);
+
+            if(!isSourceDirectory || !isShaderFile(p))
+                continue;
+
+            std::string filename  = p.stem().string();
+            std::string extension = p.extension().string();
+            ShaderId id = findShader(p);
+            if(id != sNoShader) {
+                // Saved without changing the contents
+                if(!checkModified(p, sShaders.Stats[id], sShaders.Hashes[id])) {
+                    Log(LogLevel::Debug) << "- File " << filename + extension << " saved without changes, skipping";
+                    continue;
+                }
+                Log(LogLevel::Info) << "- File " << filename + extension << " is modified, recompiling...";
+            } else {
+                std::string source;
+                id = addShaderEntry(p, source);
+                // Add it to the directory's listing too, so its removal is noticed when the directory is re-enumerated
+                std::vector<fs::path>& shaders = sDirectoryEntries[directory].Shaders;
+                if(std::find(shaders.begin(), shaders.end(), p) == shaders.end())
+                    shaders.push_back(p);
+                Log(LogLevel::Info) << "- Newly recognized file: " << filename + extension << ", compiling...";
+            }
+            queueCompile(p, sShaders.Stats[id].WriteTime);
+        }
+    }
+    if(rescan) {
+        scanShaders(path);
+    } else {
+        for(const fs::path& directory : rescanDirectories)
+            if(sDirectoryEntries.find(directory) != sDirectoryEntries.end())
+                scanDirectory(directory);
+    }
+    traceSpan("scan", "file events", started, std::chrono::steady_clock::now());
+}
+
+// Main thread event loop; a single epoll wait reacts immediately to user commands on stdin, file events (inotify), the poll 
+// interval (timerfd) and wake-ups from other threads (eventfd: finished compiles, quit). Returns false when the loop couldn't
+// be set up or failed, in which case the caller falls back to a polling watcher thread
+// --------------------------------------------------------------------------------------------------------------------------
+bool runEventLoop(fs::path path) {
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if(epollFd < 0 || sWakeEventFd < 0) {
+        Log(LogLevel::Warning) << "Failed to create the event loop, falling back to polling";
+        if(epollFd >= 0)
+            close(epollFd);
+        return false;
+    }
+    // Watch for file events, or rescan the shader folder every second when polling (or when inotify isn't available)
+    int inotifyFd = -1;
+    int timerFd   = -1;
+    if(config.WatchMode != "poll") {
+        inotifyFd = initInotify(path);
+        if(inotifyFd < 0)
+            Log(LogLevel::Warning) << "Failed to initialize inotify, falling back to polling";
+    }
+    if(inotifyFd < 0) {
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        itimerspec interval = { { 1, 0 }, { 1, 0 } };
+        timerfd_settime(timerFd, 0, &interval, nullptr);
+    }
+    auto addFd = [epollFd](int fd) {
+        epoll_event event = {};
+        event.events  = EPOLLIN;
+        event.data.fd = fd;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    };
+    bool ok = addFd(sWakeEventFd) && addFd(inotifyFd >= 0 ? inotifyFd : timerFd);
+    // Engines connecting to the notification socket
+    if(ok && sNotifyListenFd >= 0)
+        ok = addFd(sNotifyListenFd);
+    // Regular files (stdin redirected from a file) can't be added to epoll; they're always readable so just keep reading them
+    bool stdinAlwaysReady = false;
+    bool stdinOpen        = true;
+    if(ok && !addFd(STDIN_FILENO)) {
+        stdinAlwaysReady = errno == EPERM;
+        ok = stdinAlwaysReady;
+    }
+
+    // Register all shaders present on startup (and compile them if specified in .ini)
+    if(ok)
+        scanShaders(path);
+
+    std::string input;
+    char buffer[4096];
+    epoll_event events[8];
+    while(ok && !sApplicationExit) {
+        int count = epoll_wait(epollFd, events, 8, stdinAlwaysReady ? 0 : -1);
+        if(count < 0) {
+            if(errno == EINTR)
+                continue;
+            ok = false;
+            break;
+        }
+        bool saveWhenIdle = false;
+        for(int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if(fd == sWakeEventFd) {
+                uint64_t value;
+                (void)read(sWakeEventFd, &value, sizeof(value));
+                saveWhenIdle = true;
+            } else if(fd == inotifyFd) {
+                handleInotifyEvents(path, inotifyFd);
+                saveWhenIdle = true;
+            } else if(fd == timerFd) {
+                uint64_t expirations;
+                (void)read(timerFd, &expirations, sizeof(expirations));
+                scanShaders(path);
+                saveWhenIdle = true;
+            } else if(fd == sNotifyListenFd) {
+                acceptSubscribers();
+            }
+        }
+        // User input; process every complete line right away. At the end of input (e.g. started in the background or as a service)
+        // stop reading it and keep watching; only a quit command or a signal stops ShaderAssist
+        bool readInput = stdinAlwaysReady;
+        for(int i = 0; i < count; ++i)
+            readInput |= events[i].data.fd == STDIN_FILENO;
+        if(readInput && stdinOpen) {
+            ssize_t length = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if(length > 0) {
+                input.append(buffer, length);
+            } else if(length == 0 || errno != EINTR) {
+                input.push_back('\n');
+                if(!stdinAlwaysReady)
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, STDIN_FILENO, nullptr);
+                stdinAlwaysReady = false;
+                stdinOpen        = false;
+            }
+            size_t end;
+            while((end = input.find('\n')) != std::string::npos) {
+                std::string line = input.substr(0, end);
+                input.erase(0, end + 1);
+                if(!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if(!processCommand(line))
+                    sApplicationExit = true;
+            }
+        }
+        if(sApplicationExit)
+            break;
+        if(sRecompile)
+            scanShaders(path);
+        // Persist the manifest and bundle whenever the last compile of a batch finishes (workers signal through the wake eventfd) or
+        // a scan removed shaders without compiling anything (both only write when something changed)
+        if(saveWhenIdle) {
+            bool idle;
+            {
+                std::lock_guard<std::mutex> lock(sCompileQueueMutex);
+                idle = sCompilesInFlight.empty() && sCompileQueue.empty();
+            }
+            if(idle) {
+                saveManifest();
+                saveBundle();
+            }
+        }
+    }
+    if(!ok && !sApplicationExit)
+        Log(LogLevel::Warning) << "Failed to wait for events, falling back to polling";
+
+    if(inotifyFd >= 0)
+        releaseInotify(inotifyFd);
+    if(timerFd >= 0)
+        close(timerFd);
+    close(epollFd);
+    return ok || sApplicationExit;
+}
+#endif
+
+// Start watching the shader directory on a separate thread; used where the event loop isn't available
+// ---------------------------------------------------------------------------------------------------
+void watchShaders(fs::path path) {
+#ifndef __linux__
+    if(config.WatchMode == "inotify")
+        Log(LogLevel::Warning) << "inotify watching is only supported on Linux, falling back to polling";
+#endif
+    watchShadersPoll(path);
+}
+
+// Watch the shader directory on a background thread until exit is set (benchmark and latency probe; the event loop owns stdin);
+// reacts to inotify events when inotifyFd is valid, otherwise re-scans every second
+// ---------------------------------------------------------------------------------------------------------------------------
+std::thread startWatcherThread(const fs::path& path, int inotifyFd, std::atomic<bool>& exit) {
+#ifdef __linux__
+    if(sWakeEventFd < 0)
+        sWakeEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(inotifyFd >= 0) {
+        return std::thread([path, inotifyFd, &exit] {
+            std::array<pollfd, 2> pollFds = {{ { inotifyFd, POLLIN, 0 }, { sWakeEventFd, POLLIN, 0 } }};
+            while(!exit) {
+                if(poll(pollFds.data(), pollFds.size(), -1) <= 0)
+                    continue;
+                if(pollFds[1].revents & POLLIN) {
+                    uint64_t value;
+                    (void)read(sWakeEventFd, &value, sizeof(value));
+                }
+                if(pollFds[0].revents & POLLIN)
+                    handleInotifyEvents(path, inotifyFd);
+            }
+        });
+    }
+#endif
+    return std::thread([path, &exit] {
+        while(!exit) {
+            scanShaders(path);
+            for(int i = 0; i < 100 && !exit; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+}
+
+void stopWatcherThread(std::thread& watcher, std::atomic<bool>& exit) {
+    exit = true;
+    wakeEventLoop();
+    watcher.join();
+}
+
+// Heap allocations made by the calling thread; counted by replacing the global allocation functions (see runAllocationCheck).
+// Only in builds with -DSHADERASSIST_ALLOC_CHECK, so regular builds keep the standard library's allocator
+// -----------------------------------------------------------------------------------------------------------------------
+#ifdef SHADERASSIST_ALLOC_CHECK
+static thread_local uint64_t sThreadAllocations = 0;
+
+void* operator new(size_t size) {
+    ++sThreadAllocations;
+    if(size == 0)
+        size = 1;
+    // Like the standard allocation function, give the new handler a chance to free memory before failing
+    while(true) {
+        if(void* memory = std::malloc(size))
+            return memory;
+        std::new_handler handler = std::get_new_handler();
+        if(!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+// GCC mistakes the replaced pair for a mismatched one once the delete is inlined into a delete-expression
+#if defined __GNUC__ && !defined __clang__
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
+#if defined __GNUC__ && !defined __clang__
+    #pragma GCC diagnostic pop
+#endif
+#endif
+
+#if defined __linux__ || defined __unix__
+// Benchmark (--bench); generates a synthetic shader tree and runs the watcher and compile scheduler against a stand-in compiler 
+// (ShaderAssist itself, see runMockCompiler) so the numbers are repeatable without a GPU or Vulkan SDK
+// ---------------------------------------------------------------------------------------------------------------------------
+struct BenchmarkOptions {
+    unsigned int Files              = 1000; // number of shaders
+    unsigned int Depth              = 3;    // directory depth of the tree (4 subdirectories per level)
+    unsigned int Fanout             = 2;    // includes per shader
+    unsigned int CompileMilliseconds = 5;   // time the stand-in compiler sleeps per shader
+    unsigned int Samples            = 20;   // detection latency samples (single shader modifications)
+    bool         Poll               = false; // measure detection with the polling watcher instead of inotify
+};
+
+// Stand-in compiler used by the benchmark; started as the compiler with the hidden --mock-compiler <ms> ahead of the glslc 
+// command line (<input> -o <output>), sleeps that many milliseconds and writes a fake SPIR-V module
+// -----------------------------------------------------------------------------------------------------------------------
+int runMockCompiler(unsigned int milliseconds, int argc, char** argv) {
+    std::string input, output;
+    for(int i = 0; i < argc; ++i) {
+        std::string argument = argv[i];
+        if(argument == "--version") {
+            std::cout << "shaderassist mock compiler" << std::endl;
+            return 0;
+        } else if(argument == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            input = argument;
+        }
+    }
+    std::string source;
+    if(!readFile(input, source)) {
+        std::cout << input << ": error: unable to open file" << std::endl;
+        return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    // SPIR-V header (magic, version 1.0, generator, bound, schema) followed by the source's hash so outputs differ per source
+    uint64_t hash = hashBytes(source.data(), source.size());
+    uint32_t words[7] = { 0x07230203, 0x00010000, 0, 1, 0, static_cast<uint32_t>(hash), static_cast<uint32_t>(hash >> 32) };
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(words), sizeof(words));
+    return file ? 0 : 1;
+}
+
+// Write the synthetic tree; shaders are spread over the leaf directories and each includes Fanout files of a shared include pool
+void generateBenchmarkTree(const fs::path& root, const BenchmarkOptions& options) {
+    unsigned int includeCount = std::max(16u, options.Fanout);
+    fs::create_directories(root / "include");
+    for(unsigned int i = 0; i < includeCount; ++i)
+        std::ofstream(root / "include" / ("common" + std::to_string(i) + ".glsl")) << "// include " << i << "\nvec4 common" << i << "() { return vec4(" << i << "); }\n";
+
+    const char* extensions[4] = { ".vert", ".frag", ".comp", ".geom" };
+    for(unsigned int i = 0; i < options.Files; ++i) {
+        fs::path directory = root;
+        std::string up;
+        for(unsigned int level = 0, index = i; level < options.Depth; ++level, index /= 4) {
+            directory /= "d" + std::to_string(index % 4);
+            up += "../";
+        }
+        fs::create_directories(directory);
+        std::ofstream file(directory / ("shader" + std::to_string(i) + extensions[i % 4]));
+        file << "#version 450\n";
+        for(unsigned int include = 0; include < options.Fanout; ++include)
+            file << "#include \"" << up << "include/common" << (i + include * 7) % includeCount << ".glsl\"\n";
+        file << "void main() {}\n";
+    }
+}
+
+// CPU time (user + system) used by all threads of this process
+int64_t processCPUMicroseconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (static_cast<int64_t>(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// Stand-alone configuration watching a freshly generated synthetic tree in the temp folder; returns the root to remove afterwards
+fs::path setupBenchmarkTree(const BenchmarkOptions& options) {
+    config.CompileOnStartup     = false;
+    config.GenerateMetaData     = false;
+    config.SPIRVExt             = ".spv";
+    config.OutputName           = "{file}{spirv_ext}";
+    config.CompileCachePath     = "";
+    std::map<std::string, std::string> defaultStages;
+    configureShaderStages(defaultStages);
+
+    fs::path benchmarkRoot = fs::temp_directory_path() / ("shaderassist_bench_" + std::to_string(getpid()));
+    sShaderSourceRoot      = benchmarkRoot / "shaders";
+    sSPIRVOutputRoot       = benchmarkRoot / "spirv";
+    config.ShaderSourcePath = sShaderSourceRoot.string();
+    config.SPIRVOutputPath  = sSPIRVOutputRoot.string();
+    fs::remove_all(benchmarkRoot);
+    generateBenchmarkTree(sShaderSourceRoot, options);
+    fs::create_directories(sSPIRVOutputRoot);
+    return benchmarkRoot;
+}
+
+int runBenchmark(const BenchmarkOptions& options, const std::string& executable) {
+    // glslc-style command line pointing at this executable acting as the stand-in compiler
+    fs::path benchmarkRoot = setupBenchmarkTree(options);
+    config.UseGoogleSPIRV       = true;
+    config.UseInProcessCompiler = false;
+    config.GLSLCPath            = executable;
+    config.WatchMode            = options.Poll ? "poll" : "inotify";
+    config.DebounceMilliseconds = 0;
+    if(config.Jobs == 0)
+        config.Jobs = std::max(1u, std::thread::hardware_concurrency());
+    sCompilerLeadingArguments   = { "--mock-compiler", std::to_string(options.CompileMilliseconds) };
+
+    Log(LogLevel::Info) << "Benchmark: " << options.Files << " shaders, depth " << options.Depth << ", " << options.Fanout << " include(s) per shader, "
+                        << options.CompileMilliseconds << "ms per compile, " << config.Jobs << " job(s), no debounce (in " << benchmarkRoot.string() << ")";
+    // Keep the per-shader messages out of the results
+    sLogLevel = LogLevel::Warning;
+
+    // Set up inotify first so the directories get watched as the startup scan enumerates them
+    std::string watcherName = "poll";
+    int inotifyFd = -1;
+#ifdef __linux__
+    inotifyFd = options.Poll ? -1 : initInotify(sShaderSourceRoot);
+    if(inotifyFd >= 0)
+        watcherName = "inotify";
+#endif
+
+    // Startup scan: registering every shader and include (and recording the baseline manifest)
+    auto start = std::chrono::steady_clock::now();
+    scanShaders(sShaderSourceRoot);
+    int64_t startupScan = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    // Idle cost of a polling pass over the unchanged tree
+    const int idlePasses = 10;
+    int64_t idleCPU = processCPUMicroseconds();
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < idlePasses; ++i)
+        scanShaders(sShaderSourceRoot);
+    int64_t idleWall = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / idlePasses;
+    idleCPU = (processCPUMicroseconds() - idleCPU) / idlePasses;
+
+    // Entry lookup cost per shader (the part of a scan besides the stat call); the shader table against an ordered map of paths
+    std::vector<fs::path> shaders;
+    for(ShaderId id = 0; id < sShaders.Status.size(); ++id)
+        if(sShaders.Status[id] == ShaderWatched)
+            shaders.push_back(shaderPath(id));
+    std::map<fs::path, ShaderEntry> entryMap;
+    for(const fs::path& shader : shaders)
+        entryMap[shader] = ShaderEntry();
+    const int lookupPasses = 10;
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < lookupPasses; ++i)
+        for(const fs::path& shader : shaders)
+            found += findShader(shader) != sNoShader;
+    double tableLookup = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / std::max<size_t>(1, lookupPasses * shaders.size());
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < lookupPasses; ++i)
+        for(const fs::path& shader : shaders)
+            found += entryMap.find(shader) != entryMap.end();
+    double mapLookup = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / std::max<size_t>(1, lookupPasses * shaders.size());
+    if(found != 2 * lookupPasses * shaders.size())
+        Log(LogLevel::Warning) << "Benchmark: shader table lookups failed";
+
+    // Start the compile workers and the watcher
+    std::vector<std::thread> compileWorkerThreads;
+    for(unsigned int i = 0; i < config.Jobs; ++i)
+        compileWorkerThreads.emplace_back(compileWorker, i + 1);
+    std::atomic<bool> watcherExit(false);
+    std::thread watcher = startWatcherThread(sShaderSourceRoot, inotifyFd, watcherExit);
+
+    // Idle CPU while watching (inotify blocks in the kernel, polling re-scans every second)
+    int64_t watchingCPU = processCPUMicroseconds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    watchingCPU = processCPUMicroseconds() - watchingCPU;
+
+    // Detection latency; modify single shaders one at a time and wait for their compile (or give up on it after 5 seconds)
+    LatencyWindow saveToSPIRV;
+    for(unsigned int i = 0; i < options.Samples && !shaders.empty() && !sApplicationExit; ++i) {
+        // Spread the saves over the poll interval, otherwise every save lands right after a scan
+        if(inotifyFd < 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds((i * 337) % 1000));
+        unsigned int compiled = sCompiledCount + sFailedCount;
+        auto saved = std::chrono::steady_clock::now();
+        std::ofstream(shaders[(i * 7919) % shaders.size()], std::ios::app) << "// sample " << i << "\n";
+        auto timeout = saved + std::chrono::seconds(5);
+        std::unique_lock<std::mutex> lock(sCompileQueueMutex);
+        while((sCompiledCount + sFailedCount == compiled || !sCompileQueue.empty() || !sCompilesInFlight.empty()) && std::chrono::steady_clock::now() < timeout && !sApplicationExit)
+            sCompileFinishedCondition.wait_for(lock, std::chrono::milliseconds(10));
+        saveToSPIRV.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - saved).count(), options.Samples);
+    }
+    std::array<int64_t, 4> detection, total = summarizeWindow(saveToSPIRV);
+    {
+        std::lock_guard<std::mutex> lock(sStatisticsMutex);
+        detection = summarizeWindow(sStageStatistics[StageDetection]);
+    }
+
+    // Rebuild throughput; modify every shader at once (e.g. a branch switch) and time until all are compiled again
+    unsigned int compiledBefore = sCompiledCount + sFailedCount;
+    start = std::chrono::steady_clock::now();
+    for(const fs::path& shader : shaders)
+        std::ofstream(shader, std::ios::app) << "// rebuild\n";
+    {
+        // Give up when no compile finishes for 10 seconds
+        unsigned int finished = compiledBefore;
+        auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        std::unique_lock<std::mutex> lock(sCompileQueueMutex);
+        while((sCompiledCount + sFailedCount - compiledBefore < shaders.size() || !sCompileQueue.empty() || !sCompilesInFlight.empty()) && std::chrono::steady_clock::now() < timeout && !sApplicationExit) {
+            sCompileFinishedCondition.wait_for(lock, std::chrono::milliseconds(10));
+            if(sCompiledCount + sFailedCount != finished) {
+                finished = sCompiledCount + sFailedCount;
+                timeout  = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            }
+        }
+    }
+    double rebuildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    unsigned int failed = sFailedCount;
+    bool interrupted = sApplicationExit;
+
+    // Shut down and clean up
+    stopWatcherThread(watcher, watcherExit);
+#ifdef __linux__
+    if(inotifyFd >= 0)
+        releaseInotify(inotifyFd);
+#endif
+    stopCompileWorkers(compileWorkerThreads);
+    std::error_code error;
+    fs::remove_all(benchmarkRoot, error);
+    if(interrupted) {
+        sLogLevel = LogLevel::Info;
+        Log(LogLevel::Error) << "Benchmark interrupted";
+        return 1;
+    }
+
+    sLogLevel = LogLevel::Info;
+    char line[256];
+    snprintf(line, sizeof(line), "startup scan:          %.1fms (%.2fus per shader)", startupScan / 1000.0, static_cast<double>(startupScan) / std::max(1u, options.Files));
+    Log(LogLevel::Info) << line;
+    snprintf(line, sizeof(line), "idle poll pass:        %.2fms wall, %.2fms CPU (%.2fus per shader)", idleWall / 1000.0, idleCPU / 1000.0, 
+             static_cast<double>(idleWall) / std::max(1u, options.Files));
+    Log(LogLevel::Info) << line;
+    snprintf(line, sizeof(line), "entry lookup:          %.1fns per shader (%zu shaders; ordered map of paths: %.1fns)", tableLookup, shaders.size(), mapLookup);
+    Log(LogLevel::Info) << line;
+    snprintf(line, sizeof(line), "idle CPU watching:     %.2fms per second (%s)", watchingCPU / 1000.0, watcherName.c_str());
+    Log(LogLevel::Info) << line;
+    Log(LogLevel::Info) << "detection latency:     p50 " << formatMilliseconds(detection[0]) << ", p95 " << formatMilliseconds(detection[1]) << ", p99 " << formatMilliseconds(detection[2]) 
+                        << " (from file timestamps, includes their granularity)";
+    Log(LogLevel::Info) << "save to SPIR-V:        p50 " << formatMilliseconds(total[0]) << ", p95 " << formatMilliseconds(total[1]) << ", p99 " << formatMilliseconds(total[2]);
+    snprintf(line, sizeof(line), "rebuild throughput:    %zu shaders in %.2fs (%.0f shaders/s)", shaders.size(), rebuildSeconds, shaders.size() / rebuildSeconds);
+    Log(LogLevel::Info) << line;
+    if(failed > 0)
+        Log(LogLevel::Error) << failed << " compile(s) of the stand-in compiler failed";
+    return failed > 0 ? 1 : 0;
+}
+
+// Allocation check (--alloc-check); a scan of an unchanged tree runs every second on always-on machines and must not touch the 
+// heap. Fails when an idle scan of a synthetic tree (on this thread, with the watch state warmed up) allocates anything
+// ---------------------------------------------------------------------------------------------------------------------------
+#ifdef SHADERASSIST_ALLOC_CHECK
+int runAllocationCheck(const BenchmarkOptions& options) {
+    fs::path benchmarkRoot = setupBenchmarkTree(options);
+    sLogLevel = LogLevel::Warning;
+    // The startup scan registers everything; the second one settles what the first left behind (e.g. directories it enumerated)
+    scanShaders(sShaderSourceRoot);
+    scanShaders(sShaderSourceRoot);
+
+    const int idlePasses = 10;
+    uint64_t allocations = sThreadAllocations;
+    for(int i = 0; i < idlePasses; ++i)
+        scanShaders(sShaderSourceRoot);
+    allocations = sThreadAllocations - allocations;
+
+    std::error_code error;
+    fs::remove_all(benchmarkRoot, error);
+    sLogLevel = LogLevel::Info;
+    if(allocations > 0) {
+        Log(LogLevel::Error) << "Idle scan allocated " << allocations << " time(s) in " << idlePasses << " passes over " << options.Files << " shaders";
+        return 1;
+    }
+    Log(LogLevel::Info) << "Idle scan is allocation free (" << idlePasses << " passes over " << options.Files << " shaders)";
+    return 0;
+}
+#endif
+#endif
+
+// End-to-end latency probe (--probe); repeatedly modifies a probe shader in the watched folder and measures the time until its
+// SPIR-V output appears, like an artist saving a shader would experience it, for each watcher backend
+// --------------------------------------------------------------------------------------------------------------------------
+int runLatencyProbe(unsigned int samples, const std::string& backend) {
+    // Measure the compile itself; probe sources are unique anyway, so keep them out of the compile cache
+    config.CompileCachePath = "";
+    uint8_t  stage  = findShaderStage("frag");
+    fs::path probe  = sShaderSourceRoot / ("shaderassist_probe" + sShaderStages[stage].Extensions.front());
+    fs::path output = getOutputPath(probe, stage);
+    std::vector<std::string> backends;
+#ifdef __linux__
+    if(backend != "poll")
+        backends.push_back("inotify");
+#endif
+    if(backend != "inotify")
+        backends.push_back("poll");
+    if(backends.empty()) {
+        Log(LogLevel::Error) << "Watcher backend " << backend << " isn't available on this platform";
+        return 1;
+    }
+    Log(LogLevel::Info) << "Probing save to SPIR-V latency with " << probe.string() << " (" << samples << " samples per backend, " 
+                        << config.DebounceMilliseconds << "ms debounce)";
+    sLogLevel = LogLevel::Warning;
+
+    // Register the existing shaders (compiling what's out-of-date) and wait for that to settle before measuring
+    std::vector<std::thread> compileWorkerThreads;
+    for(unsigned int i = 0; i < config.Jobs; ++i)
+        compileWorkerThreads.emplace_back(compileWorker, i + 1);
+    int inotifyFd = -1;
+#ifdef __linux__
+    if(backends.front() == "inotify")
+        inotifyFd = initInotify(sShaderSourceRoot);
+#endif
+    scanShaders(sShaderSourceRoot);
+
+    std::vector<std::string> results;
+    unsigned int timeouts = 0;
+    for(const std::string& watcherBackend : backends) {
+        std::atomic<bool> watcherExit(false);
+        std::thread watcher = startWatcherThread(sShaderSourceRoot, watcherBackend == "inotify" ? inotifyFd : -1, watcherExit);
+        LatencyWindow latencies;
+        unsigned int backendTimeouts = 0;
+        // First save creates the probe (not measured)
+        for(unsigned int i = 0; i <= samples && !sApplicationExit; ++i) {
+            {
+                std::unique_lock<std::mutex> lock(sCompileQueueMutex);
+                while((!sCompileQueue.empty() || !sCompilesInFlight.empty()) && !sApplicationExit)
+                    sCompileFinishedCondition.wait_for(lock, std::chrono::milliseconds(10));
+            }
+            // Spread the saves over the poll interval, otherwise every save lands right after a scan
+            if(watcherBackend == "poll")
+                std::this_thread::sleep_for(std::chrono::milliseconds((i * 337) % 1000));
+
+            FileStat previous = {};
+            statFile(output, previous);
+            auto saved = std::chrono::steady_clock::now();
+            std::ofstream(probe, std::ios::trunc) << "#version 450\nlayout(location = 0) out vec4 color;\nvoid main() { color = vec4(" << i << ".0); } // " 
+                                                  << watcherBackend << " probe\n";
+            // Output is moved into place once compiled, so a changed stat means the new version is complete
+            FileStat current;
+            bool appeared = false;
+            while(std::chrono::steady_clock::now() - saved < std::chrono::seconds(10) && !sApplicationExit) {
+                if(statFile(output, current) && current != previous && current.Size > 0) {
+                    appeared = true;
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+            if(i == 0)
+                continue;
+            if(appeared)
+                latencies.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - saved).count(), samples);
+            else
+                ++backendTimeouts;
+        }
+        stopWatcherThread(watcher, watcherExit);
+#ifdef __linux__
+        if(watcherBackend == "inotify" && inotifyFd >= 0) {
+            releaseInotify(inotifyFd);
+            inotifyFd = -1;
+        }
+#endif
+
+        int64_t minimum = latencies.Samples.empty() ? -1 : *std::min_element(latencies.Samples.begin(), latencies.Samples.end());
+        std::array<int64_t, 4> summary = summarizeWindow(latencies);
+        char line[256];
+        snprintf(line, sizeof(line), "%-8s %zu samples: min %s, p50 %s, p95 %s, p99 %s, max %s", watcherBackend.c_str(), latencies.Samples.size(), 
+                 formatMilliseconds(minimum).c_str(), formatMilliseconds(summary[0]).c_str(), formatMilliseconds(summary[1]).c_str(), 
+                 formatMilliseconds(summary[2]).c_str(), formatMilliseconds(summary[3]).c_str());
+        results.push_back(line);
+        if(backendTimeouts > 0)
+            results.push_back(watcherBackend + ": " + std::to_string(backendTimeouts) + " save(s) didn't reach SPIR-V within 10 seconds");
+        timeouts += backendTimeouts;
+    }
+
+    // Shut down and remove the probe again
+    bool interrupted = sApplicationExit;
+    stopCompileWorkers(compileWorkerThreads);
+    std::error_code error;
+    fs::remove(probe, error);
+    fs::remove(output, error);
+    {
+        std::lock_guard<std::mutex> lock(sManifestMutex);
+        sManifest.erase(probe);
+        sManifestDirty = true;
+    }
+    saveManifest();
+    removeBundleEntry(output);
+    saveBundle();
+
+    sLogLevel = LogLevel::Info;
+    if(interrupted) {
+        Log(LogLevel::Error) << "Probe interrupted";
+        return 1;
+    }
+    for(const std::string& result : results)
+        Log(LogLevel::Info) << result;
+    return timeouts > 0 ? 1 : 0;
+}
+
 // Parse config values from the .ini file
 // --------------------------------------
 void parseIniFile(std::ifstream& iniFile) {
@@ -142,31 +3825,159 @@ void parseIniFile(std::ifstream& iniFile) {
     }
     config.CompileOnStartup         = iniKeyValuePairs["compile_on_startup"] == "true" ? true : false;
     config.UseGoogleSPIRV           = iniKeyValuePairs["use_google_spirv"]   == "true" ? true : false;
+    config.UseInProcessCompiler     = iniKeyValuePairs["use_in_process_compiler"] == "true" ? true : false;
+    config.GenerateMetaData         = iniKeyValuePairs["generate_metadata"]  == "true" ? true : false;
     config.GLSLLangValidatorPath    = iniKeyValuePairs["glsl_lang_validator_path"];
     config.GLSLCPath                = iniKeyValuePairs["glsl_c_path"];
     config.ShaderSourcePath         = iniKeyValuePairs["shader_source_path"];
     config.SPIRVOutputPath          = iniKeyValuePairs["spirv_output_path"];
     config.SPIRVExt                 = iniKeyValuePairs["spirv_ext"];
-    config.VSExt                    = iniKeyValuePairs["vs_ext"];
-    config.FSExt                    = iniKeyValuePairs["fs_ext"];
-    config.GSExt                    = iniKeyValuePairs["gs_ext"];
-    config.CSExt                    = iniKeyValuePairs["cs_ext"];
+    config.OutputName               = iniKeyValuePairs["output_name"];
+    if(config.OutputName.empty())
+        config.OutputName = "{file}{spirv_ext}";
+    config.WatchMode                = iniKeyValuePairs["watch_mode"];
+    config.CompileCachePath         = iniKeyValuePairs["compile_cache_path"];
+    config.LogThreshold             = iniKeyValuePairs["log_level"];
+    config.LogFilePath              = iniKeyValuePairs["log_file"];
+    config.StatsFilePath            = iniKeyValuePairs["stats_file"];
+    config.TraceFilePath            = iniKeyValuePairs["trace_file"];
+    config.NotifySocketPath         = iniKeyValuePairs["notify_socket"];
+    config.SharedMemoryName         = iniKeyValuePairs["shared_memory"];
+    config.BundleFilePath           = iniKeyValuePairs["bundle_file"];
+    config.SPIRVOptPath             = iniKeyValuePairs["spirv_opt_path"];
+    config.SPIRVOptPasses           = iniKeyValuePairs["spirv_opt_passes"];
+    config.SPIRVOptCachePath        = iniKeyValuePairs["spirv_opt_cache_path"];
+    config.SharedMemoryMegabytes    = std::atoi(iniKeyValuePairs["shared_memory_size_mb"].c_str());
+    if(config.SharedMemoryMegabytes == 0)
+        config.SharedMemoryMegabytes = 64;
+    config.SharedMemoryIndexSize    = std::atoi(iniKeyValuePairs["shared_memory_index_size"].c_str());
+    config.DebounceMilliseconds     = std::atoi(iniKeyValuePairs["debounce_ms"].c_str());
+    config.Jobs                     = std::atoi(iniKeyValuePairs["jobs"].c_str());
+    if(config.Jobs == 0)
+        config.Jobs = std::max(1u, std::thread::hardware_concurrency());
+    configureShaderStages(iniKeyValuePairs);
 }
 
 // Program entry
 // -------------
 int main(int argc, char** argv) {
-    fs::path currentPath = fs::current_path();
+#ifdef __linux__
+    // Started by runProcess to run a compiler that dies with ShaderAssist
+    if(argc > 3 && std::string(argv[1]) == "--run-child")
+        return runChild(std::atoi(argv[2]), argv + 3);
+#endif
+#if defined __linux__ || defined __unix__
+    // Started by the benchmark as its stand-in compiler
+    if(argc > 2 && std::string(argv[1]) == "--mock-compiler")
+        return runMockCompiler(std::atoi(argv[2]), argc - 3, argv + 3);
+    bool benchmark = false;
+#ifdef SHADERASSIST_ALLOC_CHECK
+    bool allocationCheck = false;
+#endif
+    BenchmarkOptions benchmarkOptions;
+#endif
+
+    // Parse command line arguments
+    unsigned int jobs = 0;
+    bool         probe = false;
+    unsigned int samples = 0;
+    std::string  watchBackend;
+    for(int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if(argument == "--once" || argument == "--build") {
+            sBuildMode = true;
+#if defined __linux__ || defined __unix__
+        } else if(argument == "--bench") {
+            benchmark = true;
+#ifdef SHADERASSIST_ALLOC_CHECK
+        } else if(argument == "--alloc-check") {
+            allocationCheck = true;
+#endif
+        } else if(argument == "--files" && i + 1 < argc) {
+            benchmarkOptions.Files = std::atoi(argv[++i]);
+        } else if(argument == "--depth" && i + 1 < argc) {
+            benchmarkOptions.Depth = std::atoi(argv[++i]);
+        } else if(argument == "--fanout" && i + 1 < argc) {
+            benchmarkOptions.Fanout = std::atoi(argv[++i]);
+        } else if(argument == "--compile-ms" && i + 1 < argc) {
+            benchmarkOptions.CompileMilliseconds = std::atoi(argv[++i]);
+#endif
+        } else if(argument == "--probe") {
+            probe = true;
+        } else if(argument == "--samples" && i + 1 < argc) {
+            samples = std::atoi(argv[++i]);
+        } else if(argument == "--poll" || argument == "--inotify") {
+            watchBackend = argument.substr(2);
+        } else if((argument == "-j" || argument == "--jobs") && i + 1 < argc) {
+            jobs = std::atoi(argv[++i]);
+        } else if(argument.size() > 2 && argument.compare(0, 2, "-j") == 0) {
+            jobs = std::atoi(argument.c_str() + 2);
+        } else {
+            Log(LogLevel::Error) << "Unknown argument: " << argument;
+            Log(LogLevel::Info) << "usage: shaderassist [--once|--build] [-j <jobs>]";
+            Log(LogLevel::Info) << "       shaderassist --bench [--files <n>] [--depth <d>] [--fanout <f>] [--compile-ms <t>] [--samples <s>] [--poll] [-j <jobs>]";
+            Log(LogLevel::Info) << "       shaderassist --probe [--samples <s>] [--poll|--inotify] [-j <jobs>]";
+#ifdef SHADERASSIST_ALLOC_CHECK
+            Log(LogLevel::Info) << "       shaderassist --alloc-check [--files <n>] [--depth <d>] [--fanout <f>]";
+#endif
+            return 1;
+        }
+    }
+    // Every mode cancels its running compiles on SIGINT/SIGTERM; those run in their own process groups, which a signal sent to
+    // ShaderAssist's process group (e.g. Ctrl+C or a cancelled CI job) doesn't reach
+    installQuitSignalHandlers();
+
+#if defined __linux__ || defined __unix__
+    // Benchmark runs stand-alone on a generated shader tree (no .ini needed)
+    if(benchmark) {
+        config.Jobs = jobs;
+        benchmarkOptions.Poll = watchBackend == "poll";
+        if(samples > 0)
+            benchmarkOptions.Samples = samples;
+        startLogger();
+        std::error_code error;
+        fs::path executable = fs::read_symlink("/proc/self/exe", error);
+        int result = runBenchmark(benchmarkOptions, error ? fs::absolute(argv[0]).string() : executable.string());
+        stopLogger();
+        return result;
+    }
+#ifdef SHADERASSIST_ALLOC_CHECK
+    if(allocationCheck) {
+        startLogger();
+        int result = runAllocationCheck(benchmarkOptions);
+        stopLogger();
+        return result;
+    }
+#endif
+#endif
 
     // Extract configuration from .ini file 
     std::ifstream ini("shaderassist.ini");
     if(!ini.is_open()) {
-        std::cout << "Failed to read .ini file" << std::endl;
+        Log(LogLevel::Error) << "Failed to read .ini file";
         return 1;
     } else {
         parseIniFile(ini);
     }
+    if(jobs > 0)
+        config.Jobs = jobs;
+    startLogger();
+    if(!config.TraceFilePath.empty())
+        startTrace(config.TraceFilePath, config.Jobs);
     
+    // Set up the in-process compile engine once for all compiles; fall back to the external compiler when unavailable
+    if(config.UseInProcessCompiler) {
+#ifdef SHADERASSIST_SHADERC
+        if(!initInProcessCompiler()) {
+            Log(LogLevel::Warning) << "Failed to initialize the in-process compiler, using the external compiler instead";
+            config.UseInProcessCompiler = false;
+        }
+#else
+        Log(LogLevel::Warning) << "ShaderAssist was built without in-process compiler support (SHADERASSIST_SHADERC), using the external compiler instead";
+        config.UseInProcessCompiler = false;
+#endif
+    }
+
     // Create a spirv directory for generated output spirv results
     if(config.SPIRVOutputPath[0] != '/' && config.SPIRVOutputPath[0] != '\\' && config.SPIRVOutputPath[1] != ':') {
         fs::path spirvPath = fs::current_path().append(config.SPIRVOutputPath);
@@ -174,38 +3985,132 @@ int main(int argc, char** argv) {
     } else {
         fs::create_directory(config.SPIRVOutputPath);
     }
+    // Resolve the source and output folders to absolute paths (without trailing separators) for comparing and mirroring subdirectories
+    sSPIRVOutputRoot  = fs::absolute(config.SPIRVOutputPath).lexically_normal();
+    sShaderSourceRoot = fs::absolute(config.ShaderSourcePath.empty() ? fs::current_path() : fs::path(config.ShaderSourcePath)).lexically_normal();
+    if(!sSPIRVOutputRoot.has_filename())
+        sSPIRVOutputRoot = sSPIRVOutputRoot.parent_path();
+    if(!sShaderSourceRoot.has_filename())
+        sShaderSourceRoot = sShaderSourceRoot.parent_path();
+    if(!fs::is_directory(sShaderSourceRoot)) {
+        Log(LogLevel::Error) << "Shader source folder " << sShaderSourceRoot.string() << " doesn't exist";
+        stopTrace();
+        stopLogger();
+        return 1;
+    }
+    initCompileCache();
+    initOptimizer();
+    loadManifest();
+    loadBundle();
 
-    // Print introductory message
-    std::cout << "ShaderAssist, 2018" << std::endl;
-    std::cout << "Enter -h for the list of commands." << std::endl;
-    
-    // Wait a short duration before starting the thread job to give std output the time to write the introductory message (before thread spams std output)
-    // A more proper way would be to use some mutex for shared cout access, but this works just as fine :)
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // Save to SPIR-V latency self-test against the .ini-specified compiler and folders
+    if(probe) {
+        int result = runLatencyProbe(samples > 0 ? samples : 20, watchBackend);
+        stopTrace();
+#ifdef SHADERASSIST_SHADERC
+        releaseInProcessCompiler();
+#endif
+        stopLogger();
+        return result;
+    }
+
+#if defined __linux__ || defined __unix__
+    initNotifySocket();
+    initSharedSPIRV();
+#endif
 
-    // Start a thread to check for shaders, keep main thread for processing additional user input
-    std::thread watchShaderThread(watchShaders, currentPath);
+    // Headless batch build; compile everything out-of-date on all cores, print a summary and exit (non-zero on failures)
+    if(sBuildMode) {
+        auto start = std::chrono::steady_clock::now();
+        config.DebounceMilliseconds = 0;
+        std::vector<std::thread> compileWorkerThreads;
+        for(unsigned int i = 0; i < config.Jobs; ++i)
+            compileWorkerThreads.emplace_back(compileWorker, i + 1);
 
-    // Check for user input
-    std::string line;
-    while(std::getline(std::cin, line)) {
-        if(line == "-h" || line == "-help" || line == "help") {
-            std::cout << "commands: " << std::endl;
-            std::cout << "-h|-help|help:        list of commands"       << std::endl;
-            std::cout << "-q|-quit|quit|exit:   quit ShaderAssist"      << std::endl;
-            std::cout << "-r|-recompile:        recompile all shaders"  << std::endl;
-        }
-        if(line == "-q" || line == "-quit" || line == "quit" || line == "exit") {
-            sApplicationExit = true;
-            break;
+        scanShaders(sShaderSourceRoot);
+        {
+            // (a quit signal can't notify the condition variable, so also check for it periodically)
+            std::unique_lock<std::mutex> lock(sCompileQueueMutex);
+            while((!sCompileQueue.empty() || !sCompilesInFlight.empty()) && !sApplicationExit)
+                sCompileFinishedCondition.wait_for(lock, std::chrono::milliseconds(100));
         }
-        if(line == "-r" || line == "-recompile") {
-            std::cout << "forcing recompile" << std::endl;
-            sRecompile = true;
+        bool interrupted = sApplicationExit;
+        stopCompileWorkers(compileWorkerThreads);
+        saveManifest();
+        saveBundle();
+        if(!config.StatsFilePath.empty())
+            dumpStatistics(config.StatsFilePath);
+        stopTrace();
+#if defined __linux__ || defined __unix__
+        releaseNotifySocket();
+        releaseSharedSPIRV();
+#endif
+#ifdef SHADERASSIST_SHADERC
+        releaseInProcessCompiler();
+#endif
+        // Up-to-date are the shaders that were never queued; decided at the end as an include modification can queue a shader after
+        // it was found up-to-date itself
+        unsigned int upToDateCount = 0;
+        for(ShaderId id = 0; id < sShaders.Status.size(); ++id)
+            if(sShaders.Status[id] == ShaderWatched && sCompileGenerations.find(shaderPath(id)) == sCompileGenerations.end())
+                ++upToDateCount;
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        if(interrupted) {
+            Log(LogLevel::Error) << "Build interrupted after " << milliseconds << "ms: " << sCompiledCount << " compiled, " << sRestoredCount << " restored from cache, " 
+                                 << sFailedCount << " failed";
+            stopLogger();
+            return 1;
         }
+        Log(LogLevel::Info) << "Build finished in " << milliseconds << "ms using " << config.Jobs << " job(s): " << sCompiledCount << " compiled, " 
+                            << sRestoredCount << " restored from cache, " << upToDateCount << " up-to-date, " << sFailedCount << " failed";
+        stopLogger();
+        return sFailedCount > 0 ? 1 : 0;
     }
-    
-    // Exit
-    watchShaderThread.join();
+
+    // Print introductory message
+    Log(LogLevel::Info) << "ShaderAssist, 2018";
+    Log(LogLevel::Info) << "Enter -h for the list of commands.";
+
+#ifdef __linux__
+    sWakeEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+
+    // Start the compile workers; the main thread runs the event loop for user input and file changes
+    std::vector<std::thread> compileWorkerThreads;
+    for(unsigned int i = 0; i < config.Jobs; ++i)
+        compileWorkerThreads.emplace_back(compileWorker, i + 1);
+#ifdef __linux__
+    sEventLoopRunning = true;
+    bool eventLoop    = runEventLoop(sShaderSourceRoot);
+    sEventLoopRunning = false;
+#else
+    bool eventLoop    = false;
+#endif
+    // Without the event loop; a separate thread checks for shaders, keep main thread for processing additional user input
+    if(!eventLoop) {
+        std::thread watchShaderThread(watchShaders, sShaderSourceRoot);
+        std::string line;
+        while(!sApplicationExit && std::getline(std::cin, line))
+            if(!processCommand(line))
+                sApplicationExit = true;
+        // At the end of input keep watching until a quit signal
+        watchShaderThread.join();
+    }
+
+    // Exit (shaders still waiting in the compile queue are dropped, running compiler processes are terminated)
+    stopCompileWorkers(compileWorkerThreads);
+    saveManifest();
+    saveBundle();
+    if(!config.StatsFilePath.empty())
+        dumpStatistics(config.StatsFilePath);
+    stopTrace();
+#if defined __linux__ || defined __unix__
+    releaseNotifySocket();
+    releaseSharedSPIRV();
+#endif
+#ifdef SHADERASSIST_SHADERC
+    releaseInProcessCompiler();
+#endif
+    stopLogger();
     return 0;
 }
\ No newline at end of file